@@ -2,8 +2,9 @@
  *   Data structures that describe the MIPS COFF format.
  */
 
-#ifdef HOST_ALPHA		/* Needed because of gcc uses 64 bit long  */
-#define _long int		/* integers on the DEC ALPHA architecture. */
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
+				/* Needed because of gcc uses 64 bit long  */
+#define _long int		/* integers on the DEC ALPHA and x86-64.   */
 #else
 #define _long long
 #endif
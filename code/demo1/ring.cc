@@ -8,7 +8,7 @@
 
 extern "C" {
 #include <stdio.h>
-extern int exit(int st);
+#include <stdlib.h>  // extern void exit(int st);
 }
 
 #include "ring.h"
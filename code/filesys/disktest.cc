@@ -0,0 +1,120 @@
+// disktest.cc
+//	A test routine that keeps several disk requests outstanding at
+//	once, by reading files from several threads at the same time.
+//	It only uses the FileSystem and OpenFile interfaces, so the
+//	filesys, lab4 and lab5 file systems all share it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#include "utility.h"
+#include "filesys.h"
+#include "system.h"
+#include "thread.h"
+#include "stats.h"
+#include "synch.h"
+#include "time.h"
+
+#define Contents 		(char *)"1234567890"
+#define ContentSize 		((int) strlen(Contents))
+#define ConcurrentFileSize	(ContentSize * 300)
+
+static Semaphore *readersDone;		// V'ed by each reader when done
+
+//----------------------------------------------------------------------
+// ConcurrentFileName
+// 	The name of the file read by reader "which".
+//----------------------------------------------------------------------
+
+static void
+ConcurrentFileName(char *name, int which)
+{
+    sprintf(name, "Reader%d", which);
+}
+
+//----------------------------------------------------------------------
+// ConcurrentRead
+// 	Read the file of reader "which" back, a few bytes at a time, and
+//	check what was read.
+//----------------------------------------------------------------------
+
+static void
+ConcurrentRead(_int which)
+{
+    OpenFile *openFile;
+    char name[16];
+    char *buffer = new char[ContentSize];
+    int i, numBytes;
+
+    ConcurrentFileName(name, which);
+    if ((openFile = fileSystem->Open(name)) == NULL)
+	printf("Concurrent test: unable to open file %s\n", name);
+    else {
+	for (i = 0; i < ConcurrentFileSize; i += ContentSize) {
+	    numBytes = openFile->Read(buffer, ContentSize);
+	    if ((numBytes < 10) || strncmp(buffer, Contents, ContentSize)) {
+		printf("Concurrent test: unable to read %s\n", name);
+		break;
+	    }
+	}
+	delete openFile;
+    }
+    delete [] buffer;
+    readersDone->V();
+}
+
+//----------------------------------------------------------------------
+// ConcurrentTest
+// 	Stress the disk with several requests outstanding at once: create
+//	one file per thread, then fork the threads to read them all back
+//	at the same time, and print how long the reads took, both in
+//	simulated ticks and in host (UNIX) CPU time.  This is where the
+//	order in which the disk serves requests (-ds) makes a difference.
+//----------------------------------------------------------------------
+
+void
+ConcurrentTest(int numThreads)
+{
+    OpenFile *openFile;
+    Thread *t;
+    char name[16];
+    int i, j, startTicks;
+    clock_t startTime;
+
+    printf("Concurrent read of %d %d byte files, in %d byte chunks\n",
+	numThreads, ConcurrentFileSize, ContentSize);
+    for (i = 0; i < numThreads; i++) {
+	ConcurrentFileName(name, i);
+	if (!fileSystem->Create(name, ConcurrentFileSize)
+		|| ((openFile = fileSystem->Open(name)) == NULL)) {
+	    printf("Concurrent test: can't create %s\n", name);
+	    return;
+	}
+	for (j = 0; j < ConcurrentFileSize; j += ContentSize)
+	    openFile->Write(Contents, ContentSize);
+	delete openFile;
+    }
+
+    readersDone = new Semaphore("concurrent readers", 0);
+    startTicks = stats->totalTicks;
+    startTime = clock();
+    for (i = 0; i < numThreads; i++) {
+	t = new Thread("concurrent reader");
+	t->Fork(ConcurrentRead, i);
+    }
+    for (i = 0; i < numThreads; i++)
+	readersDone->P();
+    printf("Reads took %d ticks, %d ms of host time\n",
+	stats->totalTicks - startTicks,
+	(int) ((clock() - startTime) * 1000 / CLOCKS_PER_SEC));
+    delete readersDone;
+
+    for (i = 0; i < numThreads; i++) {
+	ConcurrentFileName(name, i);
+	fileSystem->Remove(name);
+    }
+    stats->Print();
+}
@@ -5,10 +5,18 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Because the physical disk can only handle one operation at a
+//	time, requests are queued, and the interrupt handler starts the
+//	next one each time a request completes.  The queue is shared with
+//	the interrupt handler, so it is protected by disabling interrupts.
+//	Each request has a semaphore, to wake up the thread waiting for it.
+//
+//	Sectors are cached in memory, in a fixed number of slots kept on
+//	a doubly linked LRU list (by slot index).  A request that hits in
+//	the cache returns without waiting for the disk at all.  A slot is
+//	"busy" while its sector is being read or written, and the cache
+//	lock is released meanwhile, so that other threads can use the
+//	rest of the cache and queue up requests of their own.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +24,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -31,6 +40,27 @@ DiskRequestDone (_int arg)
     dsk->RequestDone();					// disk -> dsk
 }
 
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest, DiskRequest::~DiskRequest
+// 	Set up, or de-allocate, a request to read or write a sector.
+//----------------------------------------------------------------------
+
+DiskRequest::DiskRequest(int sectorNumber, char* buffer, bool isWrite)
+{
+    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    sector = sectorNumber;
+    data = buffer;
+    writing = isWrite;
+    done = FALSE;
+    finished = new Semaphore("disk request", 0);
+    next = NULL;
+}
+
+DiskRequest::~DiskRequest()
+{
+    delete finished;
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
@@ -38,13 +68,48 @@ DiskRequestDone (_int arg)
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"cacheSectors" -- size of the buffer cache, in sectors
+//	"useWriteBack" -- if TRUE, only write modified sectors to the disk
+//	   when they are evicted from the cache, or on Flush
+//	"schedulePolicy" -- the order in which to serve outstanding requests
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(const char* name)
+SynchDisk::SynchDisk(const char* name, int cacheSectors, bool useWriteBack,
+		     DiskSchedule schedulePolicy)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
+    int i;
+
+    ASSERT((cacheSectors >= 0) && (cacheSectors <= NumSectors));
     disk = new Disk(name, DiskRequestDone, (_int) this);
+    schedule = schedulePolicy;
+    active = queue = NULL;
+    headTrack = 0;
+    sweepingUp = TRUE;
+
+    lock = new Lock("synch disk lock");
+    slotFree = new Condition("synch disk slot free");
+    slotWaiters = 0;
+    cacheSize = cacheSectors;
+    writeBack = useWriteBack;
+    cacheData = new char[cacheSize * SectorSize];
+    cacheSector = new int[cacheSize];
+    cacheDirty = new bool[cacheSize];
+    cacheBusy = new bool[cacheSize];
+    lruNext = new int[cacheSize];
+    lruPrev = new int[cacheSize];
+    for (i = 0; i < cacheSize; i++) {
+	cacheSector[i] = -1;
+	cacheDirty[i] = cacheBusy[i] = FALSE;
+	lruNext[i] = i + 1;		// -1 past the end, as is lruPrev[0]
+	lruPrev[i] = i - 1;
+    }
+    if (cacheSize > 0)
+	lruNext[cacheSize - 1] = -1;
+    lruHead = 0;
+    lruTail = cacheSize - 1;
+    slotOf = new int[NumSectors];
+    for (i = 0; i < NumSectors; i++)
+	slotOf[i] = -1;
 }
 
 //----------------------------------------------------------------------
@@ -55,9 +120,18 @@ SynchDisk::SynchDisk(const char* name)
 
 SynchDisk::~SynchDisk()
 {
+    Flush();				// normally done already, by Halt
+    ASSERT(active == NULL);
     delete disk;
     delete lock;
-    delete semaphore;
+    delete slotFree;
+    delete [] cacheData;
+    delete [] cacheSector;
+    delete [] cacheDirty;
+    delete [] cacheBusy;
+    delete [] lruNext;
+    delete [] lruPrev;
+    delete [] slotOf;
 }
 
 //----------------------------------------------------------------------
@@ -72,10 +146,85 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    ReadSectors(&sectorNumber, 1, data, 0);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read a list of sectors in one go: the requests for all the ones
+//	that are not in the cache are submitted before we wait for any of
+//	them, so the disk can serve them in the best order (and, for
+//	consecutive sectors, out of its track buffer).  Return only after
+//	the data has been read.
+//
+//	We hold every slot of the batch busy until the end, so if we run
+//	out of slots -- or find a sector busy -- we finish the part of
+//	the batch we have first, rather than wait while holding slots.
+//
+//	"sectorNumbers" -- the disk sectors to read
+//	"count" -- how many of them to read into "data"
+//	"data" -- the buffer to hold the contents of the sectors, one
+//		after the other
+//	"ahead" -- how many more sectors, after the first "count" in
+//		"sectorNumbers", to read into the cache only
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int *sectorNumbers, int count, char* data, int ahead)
+{
+    int total = count + ahead;
+    int *slots;
+    DiskRequest **requests;
+    int first, i, j, slot;
+    bool hit;
+
+    requests = new DiskRequest *[total];
+    if (cacheSize == 0) {			// nowhere to read ahead to
+	for (i = 0; i < count; i++)
+	    requests[i] = Submit(sectorNumbers[i], &data[i * SectorSize],
+				 FALSE);
+	for (i = 0; i < count; i++)
+	    Wait(requests[i]);
+	delete [] requests;
+	return;
+    }
+
+    slots = new int[total];
+    lock->Acquire();
+    for (first = i = 0; first < total; ) {
+	if (i < total) {
+	    slot = GetSlot(sectorNumbers[i], &hit, i == first);
+	    if (slot >= 0) {
+		slots[i] = slot;
+		requests[i] = NULL;
+		if (hit)
+		    stats->numCacheHits++;
+		else {
+		    stats->numCacheMisses++;
+		    requests[i] = Submit(sectorNumbers[i],
+				     &cacheData[slot * SectorSize], FALSE);
+		}
+		i++;
+		continue;
+	    }
+	}
+
+	// finish the batch so far: sectors "first" up to "i"
+	lock->Release();
+	for (j = first; j < i; j++)
+	    if (requests[j] != NULL)
+		Wait(requests[j]);
+	lock->Acquire();
+	for (; first < i; first++) {
+	    if (first < count)
+		bcopy(&cacheData[slots[first] * SectorSize],
+		      &data[first * SectorSize], SectorSize);
+	    PutSlot(slots[first]);
+	}
+    }
     lock->Release();
+    delete [] slots;
+    delete [] requests;
 }
 
 //----------------------------------------------------------------------
@@ -90,20 +239,305 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    int slot;
+    bool hit;
+
+    if (cacheSize == 0) {
+	Wait(Submit(sectorNumber, data, TRUE));
+	return;
+    }
+    lock->Acquire();
+    slot = GetSlot(sectorNumber, &hit, TRUE);	// whole sector is replaced,
+    if (hit)					// so no need to read it in
+	stats->numCacheHits++;
+    else
+	stats->numCacheMisses++;
+    bcopy(data, &cacheData[slot * SectorSize], SectorSize);
+    if (writeBack)
+	cacheDirty[slot] = TRUE;
+    else {
+	lock->Release();
+	Wait(Submit(sectorNumber, &cacheData[slot * SectorSize], TRUE));
+	lock->Acquire();
+    }
+    PutSlot(slot);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write every dirty sector in the cache back to the disk.  Nothing
+//	to do for a write-through cache.  The writes are all submitted
+//	before we wait for any of them, so the disk can do them in
+//	whatever order is quickest.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    DiskRequest **requests;
+    int slot;
+
+    if (!writeBack)
+	return;
+    requests = new DiskRequest *[cacheSize];
+    lock->Acquire();
+    for (slot = 0; slot < cacheSize; slot++) {
+	requests[slot] = NULL;
+	if (cacheDirty[slot] && !cacheBusy[slot]) {
+	    cacheDirty[slot] = FALSE;
+	    cacheBusy[slot] = TRUE;
+	    requests[slot] = Submit(cacheSector[slot],
+				    &cacheData[slot * SectorSize], TRUE);
+	}
+    }
     lock->Release();
+    for (slot = 0; slot < cacheSize; slot++)
+	if (requests[slot] != NULL)
+	    Wait(requests[slot]);
+    lock->Acquire();
+    for (slot = 0; slot < cacheSize; slot++)
+	if (requests[slot] != NULL)
+	    PutSlot(slot);
+    lock->Release();
+    delete [] requests;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Queue a request to read or write a sector, and return without
+//	waiting for it; if the disk is idle, it starts right away.  The
+//	caller must not touch "data" until it has waited for the request.
+//	Requests for the same sector are always done in the order they
+//	were submitted.
+//
+//	"sectorNumber" -- the disk sector to read or write
+//	"data" -- the buffer to read into, or to write from
+//	"writing" -- TRUE for a write, FALSE for a read
+//
+//	Returns the request, to be passed to Wait.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::Submit(int sectorNumber, char* data, bool writing)
+{
+    DiskRequest *request = new DiskRequest(sectorNumber, data, writing);
+    DiskRequest *last;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (queue == NULL)
+	queue = request;
+    else {
+	for (last = queue; last->next != NULL; last = last->next)
+	    ;
+	last->next = request;
+    }
+    if (active == NULL)
+	StartNext();
+    (void) interrupt->SetLevel(oldLevel);
+    return request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Wait
+// 	Wait for a request returned by Submit to be done, then
+//	de-allocate it.
+//
+//	A write-back cache may still have to be flushed when Nachos halts
+//	because no thread is left to run.  Then there is nobody to switch
+//	to while we wait, so just let the machine idle until the disk
+//	interrupt has been delivered.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Wait(DiskRequest *request)
+{
+    if (interrupt->getStatus() == IdleMode) {
+	while (!request->done)
+	    interrupt->Idle();		// skip ahead to the disk interrupt
+	interrupt->setStatus(IdleMode);
+    }
+    request->finished->P();		// wait for interrupt
+    delete request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Distance
+// 	How many tracks the head has to cross to get to "sectorNumber",
+//	in the order the schedule visits them: first the ones ahead of
+//	the head in the direction it is moving, then (for SCAN) the ones
+//	behind it on the way back, or (for C-LOOK) the ones behind it
+//	starting from the lowest track.  FIFO does not care.
+//----------------------------------------------------------------------
+
+int
+SynchDisk::Distance(int sectorNumber, bool up)
+{
+    int track = sectorNumber / SectorsPerTrack;
+    int ahead = up ? (track - headTrack) : (headTrack - track);
+
+    switch (schedule) {
+      case DiskSCAN:
+	return (ahead >= 0) ? ahead : (NumTracks - ahead);
+      case DiskCLOOK:
+	return (ahead >= 0) ? ahead : (NumTracks + track);
+      default:
+	return 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	Take the next request off the queue, according to the schedule,
+//	and send it to the disk.  Among requests at the same distance,
+//	the one submitted first goes first.  Called with interrupts off,
+//	when the disk is idle.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartNext()
+{
+    DiskRequest *request, *prev, *best, *bestPrev;
+    int distance, bestDistance;
+
+    active = NULL;
+    if (queue == NULL)
+	return;
+
+    best = queue;
+    bestPrev = NULL;
+    bestDistance = Distance(queue->sector, sweepingUp);
+    for (prev = queue, request = queue->next; request != NULL;
+				prev = request, request = request->next) {
+	distance = Distance(request->sector, sweepingUp);
+	if (distance < bestDistance) {
+	    best = request;
+	    bestPrev = prev;
+	    bestDistance = distance;
+	}
+    }
+    if ((schedule == DiskSCAN) && (bestDistance > NumTracks))
+	sweepingUp = !sweepingUp;	// nothing left ahead; turn around
+
+    if (bestPrev == NULL)
+	queue = best->next;
+    else
+	bestPrev->next = best->next;
+    best->next = NULL;
+    active = best;
+    headTrack = best->sector / SectorsPerTrack;
+    if (best->writing)
+	disk->WriteRequest(best->sector, best->data);
+    else
+	disk->ReadRequest(best->sector, best->data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::GetSlot
+// 	Find the cache slot holding "sectorNumber", or else take the
+//	least recently used slot that is not busy for it, writing back its
+//	old contents first if they are dirty (in which case the old sector
+//	also maps to this slot until it is on the disk, so nobody reads it
+//	back too early).  Waits if the sector, or every slot, is busy --
+//	unless "mayWait" is FALSE, when it returns -1 instead.
+//
+//	The slot is returned busy and most recently used; the caller
+//	fills in the data if it was not a hit, and calls PutSlot.  The
+//	caller holds "lock", which may be released in the meantime.
+//
+//	"hit" is set to whether the sector was in the cache.
+//----------------------------------------------------------------------
+
+int
+SynchDisk::GetSlot(int sectorNumber, bool *hit, bool mayWait)
+{
+    int slot, victim;
+
+    for (;;) {
+	slot = slotOf[sectorNumber];
+	if (slot >= 0) {
+	    if (!cacheBusy[slot])
+		break;
+	} else {
+	    for (slot = lruTail; slot >= 0; slot = lruPrev[slot])
+		if (!cacheBusy[slot])
+		    break;
+	    if (slot >= 0)
+		break;
+	}
+	if (!mayWait)
+	    return -1;
+	slotWaiters++;
+	slotFree->Wait(lock);
+	slotWaiters--;
+    }
+    cacheBusy[slot] = TRUE;
+    Touch(slot);
+    *hit = (cacheSector[slot] == sectorNumber);
+    if (*hit)
+	return slot;
+
+    victim = cacheSector[slot];
+    cacheSector[slot] = sectorNumber;
+    slotOf[sectorNumber] = slot;
+    if (victim >= 0) {
+	stats->numCacheEvictions++;
+	if (cacheDirty[slot]) {
+	    cacheDirty[slot] = FALSE;
+	    lock->Release();
+	    Wait(Submit(victim, &cacheData[slot * SectorSize], TRUE));
+	    lock->Acquire();
+	}
+	slotOf[victim] = -1;
+    }
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PutSlot
+// 	The caller of GetSlot is done with "slot"; wake up anybody
+//	waiting for it.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::PutSlot(int slot)
+{
+    cacheBusy[slot] = FALSE;
+    if (slotWaiters > 0)
+	slotFree->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Touch
+// 	Move "slot" to the front of the LRU list.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Touch(int slot)
+{
+    if (slot == lruHead)
+	return;
+    lruNext[lruPrev[slot]] = lruNext[slot];	// unlink; not the head,
+    if (slot == lruTail)			// so there is a previous
+	lruTail = lruPrev[slot];
+    else
+	lruPrev[lruNext[slot]] = lruPrev[slot];
+    lruPrev[slot] = -1;
+    lruNext[slot] = lruHead;
+    lruPrev[lruHead] = slot;
+    lruHead = slot;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Wake up the thread waiting for the
+//	request that just finished, and start the next one.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
 { 
-    semaphore->V();
+    active->done = TRUE;
+    active->finished->V();
+    StartNext();
 }
@@ -14,6 +14,30 @@
 #include "disk.h"
 #include "synch.h"
 
+// The order in which outstanding requests are sent to the disk.
+
+enum DiskSchedule {
+    DiskFIFO,		// in the order they were submitted
+    DiskSCAN,		// elevator: sweep up the tracks, then back down
+    DiskCLOOK		// sweep up the tracks, then jump back to the lowest
+};
+
+// A read or write of one sector, submitted to a SynchDisk and not
+// yet waited for.
+
+class DiskRequest {
+  public:
+    DiskRequest(int sectorNumber, char* buffer, bool isWrite);
+    ~DiskRequest();
+
+    int sector;				// sector to read or write
+    char *data;				// where the data comes from/goes to
+    bool writing;			// write, rather than read?
+    bool done;				// has the disk finished it?
+    Semaphore *finished;		// V'ed when the disk has finished it
+    DiskRequest *next;			// next request in the queue
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -23,31 +47,93 @@
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
+// returning.  Underneath, requests from all threads are queued, and
+// each time the disk finishes one the next is picked according to the
+// disk schedule, so that the head does not seek back and forth.  A
+// thread can also Submit several requests and Wait for them later.
+//
+// Recently used sectors are kept in a buffer cache, so that the
+// file system can re-read its headers, directory and free map without
+// going to the disk every time.  The cache is LRU; writes either go
+// straight through to the disk, or (write-back) only mark the cached
+// copy dirty until the sector is evicted or the cache is flushed.
+
+#define DefaultCacheSize	32	// # of sectors in the buffer cache
+
 class SynchDisk {
   public:
-    SynchDisk(const char* name);    		// Initialize a synchronous disk,
+    SynchDisk(const char* name, int cacheSectors, bool useWriteBack,
+	      DiskSchedule schedulePolicy);
+					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
-    ~SynchDisk();			// De-allocate the synch disk data
-    
+					// "cacheSectors" of 0 turns the
+					// buffer cache off.
+    ~SynchDisk();			// Flush the cache, and de-allocate
+					// the synch disk data
+
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
     					// only once the data is actually read 
-					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+					// or written.  These go through the
+					// buffer cache, and Submit and Wait
+					// for a request if they must.
     void WriteSector(int sectorNumber, char* data);
-    
+    void ReadSectors(int *sectorNumbers, int count, char* data, int ahead);
+					// Read "count" sectors into "data",
+					// and the "ahead" sectors after them
+					// in "sectorNumbers" into the cache,
+					// all as one batch of requests
+
+    DiskRequest *Submit(int sectorNumber, char* data, bool writing);
+					// Queue a request for the disk, and
+					// return without waiting for it.
+					// Bypasses the buffer cache.
+    void Wait(DiskRequest *request);	// Wait until "request" is done,
+					// and de-allocate it
+
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
+    void Flush();			// Write all dirty cached sectors
+					// back to the disk
+
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskSchedule schedule;		// how to order the queued requests
+    DiskRequest *active;		// request the disk is working on
+    DiskRequest *queue;			// requests waiting for the disk,
+					// in the order they were submitted
+    int headTrack;			// track of the last request started
+    bool sweepingUp;			// SCAN direction
+
+    void StartNext();			// Send the next queued request to
+					// the disk; interrupts are off
+    int Distance(int sectorNumber, bool up);
+					// How far the head must sweep "up"
+					// or down to reach "sectorNumber"
+
+    Lock *lock;		  		// Protects the cache
+    Condition *slotFree;		// Signalled when a slot stops being
+					// busy
+    int slotWaiters;			// # of threads waiting on slotFree
+
+    int GetSlot(int sectorNumber, bool *hit, bool mayWait);
+					// Find "sectorNumber" in the cache,
+					// or a slot to put it in; the slot
+					// is returned busy
+    void PutSlot(int slot);		// Done with a slot from GetSlot
+    void Touch(int slot);		// Make "slot" the most recently used
+
+    int cacheSize;			// # of sectors in the cache
+    bool writeBack;			// write-back, rather than write-through
+    char *cacheData;			// contents of the cached sectors
+    int *cacheSector;			// sector in each slot, or -1 if none
+    bool *cacheDirty;			// is the slot newer than the disk?
+    bool *cacheBusy;			// is the slot being used for I/O?
+    int *slotOf;			// slot of each disk sector, or -1
+    int *lruNext, *lruPrev;		// LRU list of slots, most recently
+    int lruHead, lruTail;		// used first; free slots at the end
 };
 
 #endif // SYNCHDISK_H
@@ -33,17 +33,17 @@
 //----------------------------------------------------------------------
 
 //新增的构造函数
-Thread::Thread(const char* threadName,int priority)
+Thread::Thread(const char* threadName,int initialPriority)
 {
     name = (char*)threadName;
     stackTop = NULL;
     stack = NULL;
-    this->priority = priority;
-    if(priority<0){
-        this->priority = 0;
+    priority = initialPriority;
+    if(priority<MinPriority){
+        this->priority = MinPriority;
     }
-    else if(priority>99){
-        this->priority = 99;
+    else if(priority>MaxPriority){
+        this->priority = MaxPriority;
     }//控制优先级范围在0~99，按照要求的
     status = JUST_CREATED;
 #ifdef USER_PROGRAM
@@ -57,7 +57,7 @@ Thread::Thread(const char* threadName)
     name = (char*)threadName;
     stackTop = NULL;
     stack = NULL;
-    priority = 9;//默认优先级为9，按照要求的
+    priority = DefaultPriority;//默认优先级为9，按照要求的
     status = JUST_CREATED;
 #ifdef USER_PROGRAM
     space = NULL;
@@ -88,7 +88,7 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-		DeallocBoundedArray((char *) stack, StackSize * sizeof(_int));
+		DeallocStack((char *) stack, StackSize * sizeof(_int));
 }
 
 //----------------------------------------------------------------------
@@ -114,7 +114,7 @@ Thread::~Thread()
 void 
 Thread::Fork(VoidFunctionPtr func, _int arg)
 {
-#ifdef HOST_ALPHA
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
     DEBUG('t', "Forking thread \"%s\" with func = 0x%lx, arg = %ld\n",
 	  name, (long) func, arg);
 #else
@@ -258,15 +258,27 @@ Thread::Sleep ()
 }
 
 //----------------------------------------------------------------------
-// ThreadFinish, InterruptEnable, ThreadPrint
+// ThreadFinish, ThreadBegin, ThreadPrint
 //	Dummy functions because C++ does not allow a pointer to a member
 //	function.  So in order to do this, we create a dummy C function
 //	(which we can pass a pointer to), that then simply calls the 
 //	member function.
+//
+//	ThreadBegin is the first thing a new thread runs.  A new thread
+//	starts in ThreadRoot, not by returning from SWITCH into
+//	Scheduler::Run, so it must delete the thread that finished
+//	before it, as Run would have, before enabling interrupts.
 //----------------------------------------------------------------------
 
 static void ThreadFinish()    { currentThread->Finish(); }
-static void InterruptEnable() { interrupt->Enable(); }
+static void ThreadBegin()
+{
+    if (threadToBeDestroyed != NULL) {
+        delete threadToBeDestroyed;
+	threadToBeDestroyed = NULL;
+    }
+    interrupt->Enable();
+}
 void ThreadPrint(_int arg){ Thread *t = (Thread *)arg; t->Print(); }
 
 //----------------------------------------------------------------------
@@ -284,18 +296,18 @@ void ThreadPrint(_int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, _int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(_int));
+    stack = (int *) AllocStack(StackSize * sizeof(_int));
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
     stack[StackSize - 1] = STACK_FENCEPOST;
 #else
-    // i386 & MIPS & SPARC & ALPHA stack works from high addresses to low addresses
+    // i386 & x86-64 & MIPS & SPARC & ALPHA stack works from high addresses to low addresses
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
     stackTop = stack + StackSize - 96;
-#else  // HOST_MIPS  || HOST_i386 || HOST_ALPHA
+#else  // HOST_MIPS  || HOST_i386 || HOST_x86_64 || HOST_ALPHA
     stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
 #ifdef HOST_i386
     // the 80386 passes the return address on the stack.  In order for
@@ -381,7 +393,7 @@ Thread::StackAllocate (VoidFunctionPtr func, _int arg)
 #endif  // HOST_SNAKE
     
     machineState[PCState] = (_int) ThreadRoot;
-    machineState[StartupPCState] = (_int) InterruptEnable;
+    machineState[StartupPCState] = (_int) ThreadBegin;
     machineState[InitialPCState] = (_int) func;
     machineState[InitialArgState] = arg;
     machineState[WhenDonePCState] = (_int) ThreadFinish;
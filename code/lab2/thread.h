@@ -57,6 +57,13 @@
 #define StackSize	(sizeof(_int) * 1024)	// in words
 
 
+// Thread priorities: under a priority scheduling policy (see
+// scheduler.h), a thread with a lower priority # runs first.
+#define MinPriority	0
+#define MaxPriority	99
+#define NumPriorities	(MaxPriority + 1)
+#define DefaultPriority	9
+
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
@@ -87,7 +94,7 @@ class Thread {
 					// NOTE -- thread being deleted
 					// must not be running when delete 
 					// is called
-    Thread(const char* debugName,int priority);//增加构造方法
+    Thread(const char* debugName,int initialPriority);//增加构造方法
     // basic thread operations
 
     void Fork(VoidFunctionPtr func, _int arg); 	// Make thread run (*func)(arg)
@@ -100,9 +107,11 @@ class Thread {
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
     void setStatus(ThreadStatus st) { status = st; }
+    ThreadStatus getStatus() { return (status); }
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
     int getPriority();//增加获取优先级方法
+    void setPriority(int newPriority) { priority = newPriority; }
 
   private:
     // some of the private data for this class is listed above
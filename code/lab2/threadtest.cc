@@ -31,7 +31,7 @@ SimpleThread(_int which)
         if(num<4){
 	         printf("*** thread %d looped %d times,priority=%d\n", (int) which, num,currentThread->getPriority());
              currentThread->Yield();
-            }else if (num = 4)
+            }else if (num == 4)
             {
                printf("*** thread %d looped %d times,priority=%d\n", (int) which, num,currentThread->getPriority());
                currentThread->Finish();
@@ -35,13 +35,13 @@ void MakeTicks(int n)  // advance n ticks of simulated time将模拟时间提前
 void BarThread(_int which)
 {
     MakeTicks(N_TICKS);
-    printf("Thread %d rendezvous\n", which);
+    printf("Thread %d rendezvous\n", (int) which);
     
 
     mutex->P();
     count=count+1;
     if(count==N_THREADS){
-         printf("Thread %d is the last\n", which);
+         printf("Thread %d is the last\n", (int) which);
          turnstile2->P();   //
          turnstile1->V();   //
     }
@@ -49,7 +49,7 @@ void BarThread(_int which)
     
     turnstile1->P();
     turnstile1->V();
-    printf("Thread %d critical point\n", which);
+    printf("Thread %d critical point\n", (int) which);
 
     mutex->P();
     count=count-1;
@@ -311,7 +311,7 @@ FileWrite()
     int i, numBytes;
 
     printf("Sequential write of %d byte file, in %d byte chunks\n", 
-	FileSize, ContentSize);
+	FileSize, (int) ContentSize);
     if (!fileSystem->Create(FileName, 0)) {
       printf("Perf test: can't create %s\n", FileName);
       return;
@@ -345,7 +345,7 @@ FileRead()
     int i, numBytes;
 
     printf("Sequential read of %d byte file, in %d byte chunks\n", 
-	FileSize, ContentSize);
+	FileSize, (int) ContentSize);
 
     if ((openFile = fileSystem->Open(FileName)) == NULL) {
 	printf("Perf test: unable to open file %s\n", FileName);
@@ -378,4 +378,3 @@ PerformanceTest()
     }
     stats->Print();
 }
-
@@ -21,15 +21,15 @@
 // 	Open a Nachos file for reading and writing.  Bring the file header
 //	into memory while the file is open.
 //
-//	"sector" -- the location on disk of the file header for this file
+//	"hdrSector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
-OpenFile::OpenFile(int sector)
+OpenFile::OpenFile(int hdrSector)
 { 
     hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    hdr->FetchFrom(hdrSector);
     seekPosition = 0;
-    this->sector=sector;
+    sector=hdrSector;
 }
 
 //----------------------------------------------------------------------
@@ -1,20 +1,22 @@
 // directory.cc 
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
+//	The directory is a hash table of fixed length entries; each
 //	entry represents a single file, and contains the file name,
 //	and the location of the file header on disk.  The fixed size
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	A name is looked up by hashing it to an entry, and probing the
+//	entries after that one until the name or an entry that has never
+//	been used is found.  Removing a file leaves a "removed" entry,
+//	so that the names probed past it can still be found.
+//
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
-//
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	The table doubles in size when three quarters of its entries are
+//	in use or removed, and WriteBack then extends the directory file.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -25,6 +27,21 @@
 #include "filehdr.h"
 #include "directory.h"
 
+//----------------------------------------------------------------------
+// HashName
+// 	Hash the part of a file name that is kept in a directory entry.
+//----------------------------------------------------------------------
+
+static unsigned int
+HashName(char *name)
+{
+    unsigned int hash = 5381;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	hash = hash * 33 + (unsigned char) name[i];
+    return hash;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
@@ -37,10 +54,8 @@
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    table = NULL;
+    Resize(size);
 }
 
 //----------------------------------------------------------------------
@@ -53,30 +68,126 @@ Directory::~Directory()
     delete [] table;
 } 
 
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Move the entries in use into a new, empty table of "size"
+//	entries, dropping the removed ones.  The whole table must then
+//	be written back.
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int size)
+{
+    DirectoryEntry *old = table;
+    int oldSize = (old == NULL) ? 0 : tableSize;
+
+    table = new DirectoryEntry[size];
+    tableSize = size;
+    for (int i = 0; i < tableSize; i++) {
+	table[i].inUse = FALSE;
+	table[i].removed = FALSE;
+	table[i].isDir = FALSE;
+    }
+    numUsing = numRemoved = 0;
+    for (int i = 0; i < oldSize; i++)
+	if (old[i].inUse) {
+	    int j = HashName(old[i].name) % tableSize;
+
+	    while (table[j].inUse)
+		j = (j + 1) % tableSize;
+	    table[j] = old[i];
+	    numUsing++;
+	}
+    delete [] old;
+    resized = TRUE;
+    dirtyLow = 0;
+    dirtyHigh = tableSize - 1;
+}
+
+//----------------------------------------------------------------------
+// Directory::Changed
+// 	Note that entry "i" differs from the copy on disk.
+//----------------------------------------------------------------------
+
+void
+Directory::Changed(int i)
+{
+    if (dirtyLow > dirtyHigh)
+	dirtyLow = dirtyHigh = i;
+    else if (i < dirtyLow)
+	dirtyLow = i;
+    else if (i > dirtyHigh)
+	dirtyHigh = i;
+}
+
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table fills
+//	the file after the magic word.  Return FALSE, leaving the
+//	directory as it was, if the magic word is not there: the disk
+//	was formatted with some other layout of directory entries.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
 
-void
+bool
 Directory::FetchFrom(OpenFile *file)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int size = (file->Length() - DirectoryHeaderSize)
+			/ sizeof(DirectoryEntry);
+    int magic = 0;
+
+    (void) file->ReadAt((char *)&magic, DirectoryHeaderSize, 0);
+    if (magic != DirectoryMagic)
+	return FALSE;
+    if (size != tableSize) {
+	delete [] table;
+	table = new DirectoryEntry[size];
+	tableSize = size;
+    }
+    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry),
+			DirectoryHeaderSize);
+    numUsing = numRemoved = 0;
+    for (int i = 0; i < tableSize; i++) {
+	numUsing += table[i].inUse;
+	numRemoved += table[i].removed;
+    }
+    resized = FALSE;
+    dirtyLow = 0;
+    dirtyHigh = -1;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.  If
+//	the table has grown (or is new), the magic word is written too,
+//	the file is extended and its header written back.  Return FALSE
+//	if there was no room on the disk to extend it.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
 
-void
+bool
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int bytes = (dirtyHigh - dirtyLow + 1) * sizeof(DirectoryEntry);
+    int magic = DirectoryMagic;
+
+    if (dirtyLow > dirtyHigh)
+	return TRUE;			// nothing changed
+    if (resized)
+	(void) file->WriteAt((char *)&magic, DirectoryHeaderSize, 0);
+    if (file->WriteAt((char *)&table[dirtyLow], bytes,
+		DirectoryHeaderSize + dirtyLow * sizeof(DirectoryEntry))
+			!= bytes)
+	return FALSE;
+    if (resized)
+	file->WriteBack();		// the file header has changed
+    resized = FALSE;
+    dirtyLow = 0;
+    dirtyHigh = -1;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -90,9 +201,17 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
+    if (tableSize == 0)
+	return -1;
+    int i = HashName(name) % tableSize;
+
+    for (int probes = 0; probes < tableSize; probes++) {
+	if (!table[i].inUse && !table[i].removed)
+	    break;			// never used, so the name isn't here
         if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
 	    return i;
+	i = (i + 1) % tableSize;
+    }
     return -1;		// name not in directory
 }
 
@@ -115,31 +234,58 @@ Directory::Find(char *name)
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::IsDir
+// 	Return TRUE if "name" is in the directory, and is itself a
+//	directory.
+//
+//	"name" -- the file name to look up
+//----------------------------------------------------------------------
+
+bool
+Directory::IsDir(char *name)
+{
+    int i = FindIndex(name);
+
+    return (bool)(i != -1 && table[i].isDir);
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory.
+//	The table is grown first if adding the name would make it more
+//	than three quarters full.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the added file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDir)
 { 
     if (FindIndex(name) != -1)
 	return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    if ((numUsing + numRemoved + 1) * 4 > tableSize * 3)
+	Resize((numUsing + 1) * 4 > tableSize * 3 ? tableSize * 2 : tableSize);
+
+    int i = HashName(name) % tableSize;
+
+    while (table[i].inUse)
+	i = (i + 1) % tableSize;
+    if (table[i].removed)
+	numRemoved--;
+    table[i].inUse = TRUE;
+    table[i].removed = FALSE;
+    strncpy(table[i].name, name, FileNameMaxLen); 
+    table[i].name[FileNameMaxLen] = '\0';
+    table[i].sector = newSector;
+    table[i].isDir = isDir;
+    numUsing++;
+    Changed(i);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -158,26 +304,82 @@ Directory::Remove(char *name)
     if (i == -1)
 	return FALSE; 		// name not in directory
     table[i].inUse = FALSE;
+    table[i].removed = TRUE;
+    numUsing--;
+    numRemoved++;
+    Changed(i);
     return TRUE;	
 }
 
+//----------------------------------------------------------------------
+// FetchSubDir
+// 	Read in the directory whose file header is at "sector".
+//----------------------------------------------------------------------
+
+static Directory *
+FetchSubDir(int sector)
+{
+    OpenFile *file = new OpenFile(sector);
+    Directory *dir = new Directory(0);
+
+    ASSERT(dir->FetchFrom(file));
+    delete file;
+    return dir;
+}
+
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory, and in the directories
+//	below it.  Sub-directories are listed as "name/", followed by
+//	their contents.
+//
+//	"prefix" -- the path of this directory, printed before each name
 //----------------------------------------------------------------------
 
 void
-Directory::List()
+Directory::List(const char *prefix)
 {
    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+	if (table[i].inUse && !table[i].isDir)
+	    printf("%s%s\n", prefix, table[i].name);
+   for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse && table[i].isDir) {
+	    char *path = new char[strlen(prefix) + FileNameMaxLen + 2];
+	    Directory *dir = FetchSubDir(table[i].sector);
+
+	    sprintf(path, "%s%s/", prefix, table[i].name);
+	    printf("%s\n", path);
+	    dir->List(path);
+	    delete dir;
+	    delete [] path;
+	}
+}
+
+//----------------------------------------------------------------------
+// Directory::ReadEntry
+// 	Find the first entry in use at or after "position" in the table,
+//	and return its name and whether it is a directory.  Return the
+//	position of the entry (so the next call should ask for the one
+//	after it), or -1 if there are no more.
+//----------------------------------------------------------------------
+
+int
+Directory::ReadEntry(int position, char *name, bool *isDir)
+{
+    for (int i = position; i < tableSize; i++)
+	if (table[i].inUse) {
+	    strncpy(name, table[i].name, FileNameMaxLen + 1);
+	    *isDir = table[i].isDir;
+	    return i;
+	}
+    return -1;
 }
 
 //----------------------------------------------------------------------
 // Directory::Print
 // 	List all the file names in the directory, their FileHeader locations,
-//	and the contents of each file.  For debugging.
+//	and the contents of each file, then do the same for each
+//	sub-directory.  For debugging.
 //----------------------------------------------------------------------
 
 void
@@ -187,12 +389,21 @@ Directory::Print()
 
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
+	if (table[i].inUse && !table[i].isDir) {
 	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
 	}
     printf("\n");
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse && table[i].isDir) {
+	    Directory *dir = FetchSubDir(table[i].sector);
+
+	    printf("Directory: %s, Sector: %d\n", table[i].name,
+			table[i].sector);
+	    dir->Print();
+	    delete dir;
+	}
     delete hdr;
 }
 
@@ -203,21 +414,39 @@ Directory::Print()
 //----------------------------------------------------------------------
 int 
 Directory::NumUsing(){
+    return numUsing;
+}
+
+//----------------------------------------------------------------------
+// Directory::NumFiles
+// 	Get the number of normal files, here and in sub-directories.
+//----------------------------------------------------------------------
+int 
+Directory::NumFiles(){
     int res=0;
-    for(int i=0;i<tableSize;i++)res+=table[i].inUse;
+    for(int i=0;i<tableSize;i++)
+    if(table[i].inUse&&table[i].isDir){
+        Directory *dir=FetchSubDir(table[i].sector);
+        res+=dir->NumFiles();
+        delete dir;
+    }else res+=table[i].inUse;
     return res;
 }
 
 //----------------------------------------------------------------------
 // Directory::BytesUsed
-// 	Get the bytes used by normal files.
+// 	Get the bytes used by normal files, here and in sub-directories.
 //----------------------------------------------------------------------
 int 
 Directory::BytesUsed(bool includingFrag){
     FileHeader *hdr=new FileHeader;
     int res=0;
     for(int i=0;i<tableSize;i++)
-    if(table[i].inUse){
+    if(table[i].inUse&&table[i].isDir){
+        Directory *dir=FetchSubDir(table[i].sector);
+        res+=dir->BytesUsed(includingFrag);
+        delete dir;
+    }else if(table[i].inUse){
         hdr->FetchFrom(table[i].sector);
         res+=hdr->NumBytes(includingFrag);
     }
@@ -227,16 +456,53 @@ Directory::BytesUsed(bool includingFrag){
 
 //----------------------------------------------------------------------
 // Directory::SectorStat
-// 	Stat of sectors in dir.
+// 	Stat of sectors of normal files in dir and its sub-directories.
 //----------------------------------------------------------------------
 int 
 Directory::SectorStat(bool onlyFragmented){
     FileHeader *hdr=new FileHeader;
     int res=0;
     for(int i=0;i<tableSize;i++)
-    if(table[i].inUse){
+    if(table[i].inUse&&table[i].isDir){
+        Directory *dir=FetchSubDir(table[i].sector);
+        res+=dir->SectorStat(onlyFragmented);
+        delete dir;
+    }else if(table[i].inUse){
         hdr->FetchFrom(table[i].sector);
         res+=onlyFragmented?hdr->NumBytes(true)!=hdr->NumBytes(false):hdr->numSectors();
     }
     return res;
+}
+
+//----------------------------------------------------------------------
+// Directory::LayoutStat
+// 	Stat of how the normal files are laid out on disk: the total
+//	number of contiguous runs of sectors, the number of files in
+//	more than one run, and the tracks crossed in the "steps" from
+//	one sector of a file to the next.  Sub-directories are included.
+//----------------------------------------------------------------------
+void
+Directory::LayoutStat(int *extents, int *scattered, int *seekTracks, int *steps){
+    FileHeader *hdr=new FileHeader;
+    int fileExtents,fileTracks;
+    *extents=*scattered=*seekTracks=*steps=0;
+    for(int i=0;i<tableSize;i++)
+    if(table[i].inUse&&table[i].isDir){
+        Directory *dir=FetchSubDir(table[i].sector);
+        int subExtents,subScattered,subTracks,subSteps;
+        dir->LayoutStat(&subExtents,&subScattered,&subTracks,&subSteps);
+        *extents+=subExtents;
+        *scattered+=subScattered;
+        *seekTracks+=subTracks;
+        *steps+=subSteps;
+        delete dir;
+    }else if(table[i].inUse){
+        hdr->FetchFrom(table[i].sector);
+        hdr->Layout(&fileExtents,&fileTracks);
+        *extents+=fileExtents;
+        *scattered+=fileExtents>1;
+        *seekTracks+=fileTracks;
+        if(hdr->numSectors()>1)*steps+=hdr->numSectors()-1;
+    }
+    delete hdr;
 }
\ No newline at end of file
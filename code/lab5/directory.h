@@ -4,7 +4,9 @@
 //      A directory is a table of pairs: <file name, sector #>,
 //	giving the name of each file in the directory, and 
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  The table is
+//	a hash table, indexed by a hash of the file name, and doubles
+//	in size when it gets three quarters full.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
@@ -19,12 +21,20 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		23	// for simplicity, we assume 
+					// file names are <= 23 characters long;
+					// this makes an entry 32 bytes
+
+#define DirectoryMagic		0x44495232	// first word of a directory
+					// file, ahead of the table; a disk
+					// with entries laid out differently
+					// must be formatted again
+#define DirectoryHeaderSize	((int) sizeof(int))
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
-// the file's header is to be found on disk.
+// the file's header is to be found on disk.  The file may itself be a
+// directory, stored the same way as the root directory.
 //
 // Internal data structures kept public so that Directory operations can
 // access them directly.
@@ -32,6 +42,9 @@
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
+    bool removed;			// Was it in use?  Lookups must probe
+					// past removed entries
+    bool isDir;				// Is the file a directory?
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
@@ -46,7 +59,10 @@ class DirectoryEntry {
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  On disk, the table follows a magic word; its size is
+// what remains of the directory file.  WriteBack extends the file when
+// the table has grown, and otherwise writes only the entries changed
+// since the last FetchFrom/WriteBack.
 
 class Directory {
   public:
@@ -54,33 +70,56 @@ class Directory {
 					// with space for "size" files
     ~Directory();			// De-allocate the directory
 
-    void FetchFrom(OpenFile *file);  	// Init directory contents from disk
-    void WriteBack(OpenFile *file);	// Write modifications to 
-					// directory contents back to disk
+    bool FetchFrom(OpenFile *file);  	// Init directory contents from disk;
+					// FALSE if it is not a directory in
+					// this format
+    bool WriteBack(OpenFile *file);	// Write modifications to 
+					// directory contents back to disk;
+					// FALSE if the file could not grow
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
+    bool IsDir(char *name);		// Is "name" a sub-directory?
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDir);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
-    void List();			// Print the names of all the files
-					//  in the directory
+    void List(const char *prefix);	// Print the names of all the files
+					//  in the directory and below it,
+					//  each after "prefix"
+    int ReadEntry(int position, char *name, bool *isDir);
+					// Get the first entry in use at or
+					//  after "position"; return where it
+					//  is, or -1 if there are no more
     void Print();			// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
-    int NumUsing();
+    int NumUsing();			// # of entries in this directory
+    int NumFiles();			// # of normal files in this directory
+					//  and below it
     int BytesUsed(bool includingFrag);
     int SectorStat(bool onlyFragmented);
+    void LayoutStat(int *extents, int *scattered, int *seekTracks,
+		    int *steps);
 
   private:
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
+    int numUsing;			// # of entries in use
+    int numRemoved;			// # of removed entries
+    int dirtyLow, dirtyHigh;		// Range of entries changed since the
+					// last FetchFrom/WriteBack
+    bool resized;			// Has the table grown since then?
 
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
+    void Resize(int size);		// Re-hash the entries into a table
+					// of "size" entries
+    void Changed(int i);		// Note that entry "i" must be
+					// written back
 };
 
 #endif // DIRECTORY_H
@@ -30,6 +30,46 @@
 #include "time.h"
 
 
+//----------------------------------------------------------------------
+// AllocateSectors
+// 	Allocate "count" data sectors out of "freeMap" into "sectors", in
+//	as few contiguous runs as we can, so that reading the file in
+//	order does not keep seeking.  First carry on from "last" (the
+//	current last sector of the file, or -1), then take the largest runs
+//	we can find, preferably within a single track.
+//
+//	The caller has checked that there are enough free sectors.
+//----------------------------------------------------------------------
+
+static void
+AllocateSectors(BitMap *freeMap, int *sectors, int count, int last)
+{
+    int n = 0, run, start, i;
+
+    while ((n < count) && (last >= 0) && (last + 1 < NumSectors)
+				&& !freeMap->Test(last + 1)) {
+	freeMap->Mark(++last);
+	sectors[n++] = last;
+    }
+    run = count - n;
+    while (n < count) {
+	if (run > count - n)
+	    run = count - n;
+	start = -1;
+	if (run <= SectorsPerTrack)
+	    start = freeMap->FindRun(run, SectorsPerTrack);
+	if (start < 0)
+	    start = freeMap->FindRun(run, 0);
+	if (start < 0) {
+	    run /= 2;				// settle for shorter runs
+	    ASSERT(run > 0);
+	    continue;
+	}
+	for (i = 0; i < run; i++)
+	    sectors[n++] = start + i;
+    }
+}
+
 FileHeader::FileHeader(){
      memset(dataSectors, 0, sizeof(dataSectors));
      dataSectors[LastIndex]=-1;
@@ -77,8 +117,11 @@ FileHeader::Extend(int newNumBytes){
         bitMap->Print();
         return false;
     }
-    //allocate
-    for(int i=numSectors();i<newNumSectors&&i<LastIndex;i++)dataSectors[i]=bitMap->Find();
+    //allocate, following on from the current last sector if we can
+    int *sectors=new int[deltaSectors];
+    int last=(numSectors()>0)?ByteToSector((numSectors()-1)*SectorSize):-1;
+    AllocateSectors(bitMap,sectors,deltaSectors,last);
+    for(int i=numSectors();i<newNumSectors&&i<LastIndex;i++)dataSectors[i]=sectors[i-numSectors()];
     if(newNumSectors>=NumDirect){//修改后的文件大小需要扇区数量多于一级索引表的大小：需要扩展二级索引
         int dataSectors2[NumDirect2],start=0;
         if(dataSectors[LastIndex]!=-1){//已经扩展了二级索引
@@ -87,9 +130,10 @@ FileHeader::Extend(int newNumBytes){
             start=numSectors()-NumDirect+1;
         }else dataSectors[LastIndex]=bitMap->Find(); //未扩展二级索引  
         //allocate for level 2
-        for(int i=start;i<=newNumSectors-NumDirect;i++)dataSectors2[i]=bitMap->Find();
+        for(int i=start;i<=newNumSectors-NumDirect;i++)dataSectors2[i]=sectors[i+LastIndex-numSectors()];
         synchDisk->WriteSector(dataSectors[LastIndex],(char*)dataSectors2);
     }
+    delete [] sectors;
     bitMap->WriteBack(openFile);
     numBytes=newNumBytes;
     return true;
@@ -114,16 +158,19 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
     if (freeMap->NumClear() < numSectors())return FALSE;//not enough disk space
     if(NumDirect+NumDirect2<=numSectors())return false;//not enough file indices
 
+    int *sectors=new int[numSectors()];
+    AllocateSectors(freeMap,sectors,numSectors(),-1);//in contiguous runs
     for (int i = 0; i < numSectors()&&i<LastIndex; i++)
-	    dataSectors[i] = freeMap->Find();
+	    dataSectors[i] = sectors[i];
     if(numSectors()<LastIndex)dataSectors[LastIndex]=-1;//no need level 2
     else{//需要二级索引
         dataSectors[LastIndex]=freeMap->Find();
         int dataSectors2[NumDirect2];
         for(int i=0;i<=numSectors()-NumDirect;i++)
-            dataSectors2[i]=freeMap->Find();
+            dataSectors2[i]=sectors[i+LastIndex];
         synchDisk->WriteSector(dataSectors[LastIndex],(char*)dataSectors2);
     }
+    delete [] sectors;
     return TRUE;
 }
 
@@ -200,6 +247,32 @@ FileHeader::ByteToSector(int offset)
     }
 }
 
+//----------------------------------------------------------------------
+// FileHeader::Layout
+// 	Report how the file's data sectors are laid out on the disk:
+//	how many contiguous runs ("extents") they make up, and how many
+//	tracks the head would cross reading them in order.
+//----------------------------------------------------------------------
+
+void
+FileHeader::Layout(int *extents, int *seekTracks)
+{
+    int i, sector, prev = -1;
+    int dataSectors2[NumDirect2];
+
+    *extents = *seekTracks = 0;
+    if(dataSectors[LastIndex]!=-1)
+        synchDisk->ReadSector(dataSectors[LastIndex],(char*)dataSectors2);
+    for (i = 0; i < numSectors(); i++) {
+        sector = (i < LastIndex) ? dataSectors[i] : dataSectors2[i-LastIndex];
+        if (sector != prev + 1 || prev < 0)
+            (*extents)++;
+        if (prev >= 0)
+            *seekTracks += abs(sector / SectorsPerTrack - prev / SectorsPerTrack);
+        prev = sector;
+    }
+}
+
 //----------------------------------------------------------------------
 // FileHeader::FileLength
 // 	Return the number of bytes in the file.
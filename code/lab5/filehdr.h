@@ -66,6 +66,9 @@ class FileHeader {
     void SetModifiedTime(int newTime);
     int GetModifiedTime();
     int NumBytes(bool includingFrag);
+    void Layout(int *extents, int *seekTracks);
+					// Count the contiguous runs of data
+					// sectors, and the tracks between them
 
   private:
     int numBytes;			// Number of bytes in the file
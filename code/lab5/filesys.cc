@@ -21,20 +21,23 @@
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
+//	The root directory is also kept in memory, as are the last few
+//	sub-directories used, so that a path can be looked up without
+//	reading the directory files along it.
+//
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
 //	are written immediately back to disk (the two files are kept
 //	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	modified part of the bitmap, we simply discard the changed
+//	version, without writing it back to disk; the in-memory directory
+//	is only changed once nothing else can fail.
 //
 // 	Our implementation at this point has the following restrictions:
 //
 //	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
 //	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
 //	   there is no attempt to make the system robust to failures
 //	    (if Nachos exits in the middle of an operation that modifies
 //	    the file system, it may corrupt the disk)
@@ -57,12 +60,12 @@
 #define FreeMapSector 		0
 #define DirectorySector 	1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directory; the directory file
+// is extended as the directory grows.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
 #define NumDirEntries 		10
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+#define DirectoryFileSize 	(DirectoryHeaderSize \
+				 + sizeof(DirectoryEntry) * NumDirEntries)
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -80,9 +83,12 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    for (int i = 0; i < DirCacheSize; i++)
+	dirCacheSector[i] = -1;
+    dirCacheClock = 0;
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        directory = new Directory(NumDirEntries);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
 
@@ -130,7 +136,6 @@ FileSystem::FileSystem(bool format)
 	    directory->Print();
         }
         delete freeMap; 
-	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
 
@@ -139,53 +144,159 @@ FileSystem::FileSystem(bool format)
     // the bitmap and directory; these are left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        directory = new Directory(NumDirEntries);
+        if (!directory->FetchFrom(directoryFile)) {
+	    printf("The disk was formatted with another layout of "
+		   "directories; format it again with -f.\n");
+	    Exit(1);
+	}
     }
 }
 
 //----------------------------------------------------------------------
-// FileSystem::Create
-// 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+// FileSystem::FetchDir
+// 	Find the directory whose file header is at "sector".  The root
+//	directory is always in memory; other directories are looked for
+//	in the cache, and read from disk into the least recently used
+//	slot if they are not there.  The directory stays valid until the
+//	next call.
+//
+//	"sector" -- the location of the directory's file header
+//	"file", "dir" -- set to the open directory file, and its contents
+//----------------------------------------------------------------------
+
+void
+FileSystem::FetchDir(int sector, OpenFile **file, Directory **dir)
+{
+    int victim = 0;
+
+    if (sector == DirectorySector) {
+	*file = directoryFile;
+	*dir = directory;
+	return;
+    }
+    dirCacheClock++;
+    for (int i = 0; i < DirCacheSize; i++) {
+	if (dirCacheSector[i] == sector) {
+	    dirCacheUsed[i] = dirCacheClock;
+	    *file = dirCacheFile[i];
+	    *dir = dirCacheDir[i];
+	    return;
+	}
+	if (dirCacheSector[victim] != -1 && (dirCacheSector[i] == -1
+			|| dirCacheUsed[i] < dirCacheUsed[victim]))
+	    victim = i;
+    }
+    DEBUG('f', "Reading directory at sector %d\n", sector);
+    if (dirCacheSector[victim] != -1) {	// cached copies are clean
+	delete dirCacheFile[victim];
+	delete dirCacheDir[victim];
+    }
+    dirCacheSector[victim] = sector;
+    dirCacheUsed[victim] = dirCacheClock;
+    dirCacheFile[victim] = new OpenFile(sector);
+    dirCacheDir[victim] = new Directory(0);
+    ASSERT(dirCacheDir[victim]->FetchFrom(dirCacheFile[victim]));
+    *file = dirCacheFile[victim];
+    *dir = dirCacheDir[victim];
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ForgetDir
+// 	Drop the directory whose file header is at "sector" from the
+//	cache, as it is being removed.
+//----------------------------------------------------------------------
+
+void
+FileSystem::ForgetDir(int sector)
+{
+    for (int i = 0; i < DirCacheSize; i++)
+	if (dirCacheSector[i] == sector) {
+	    delete dirCacheFile[i];
+	    delete dirCacheDir[i];
+	    dirCacheSector[i] = -1;
+	}
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Resolve
+// 	Walk the path "name" from the root directory, and find the
+//	directory holding its last component.  Return FALSE if one of
+//	the other components is missing, or is not a directory.
+//
+//	"name" -- the path, with components separated by "/"
+//	"leaf" -- set to the last component, cut to FileNameMaxLen, or
+//		to "" if the path names the root directory
+//	"dirSector" -- set to the file header sector of the directory
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Resolve(char *name, char *leaf, int *dirSector)
+{
+    OpenFile *dirFile;
+    Directory *dir;
+    int sector = DirectorySector;
+
+    while (*name == '/')
+	name++;
+    for (;;) {
+	int len = 0, copied;
+
+	while (name[len] != '\0' && name[len] != '/')
+	    len++;
+	copied = (len < FileNameMaxLen) ? len : FileNameMaxLen;
+	strncpy(leaf, name, copied);
+	leaf[copied] = '\0';
+	name += len;
+	while (*name == '/')
+	    name++;
+	if (*name == '\0')
+	    break;			// "leaf" is the last component
+
+	FetchDir(sector, &dirFile, &dir);
+	if (!dir->IsDir(leaf))
+	    return FALSE;
+	sector = dir->Find(leaf);
+    }
+    *dirSector = sector;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeEntry
+// 	Create a file, or an empty directory, at the path "name".  This
+//	does the work of Create and Mkdir.
 //
 //	The steps to create a file are:
-//	  Make sure the file doesn't already exist
+//	  Find the directory to put it in, and make sure the file
+//	    doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
-//	  Add the name to the directory
-//	  Store the new file header on disk 
-//	  Flush the changes to the bitmap and the directory back to disk
+//	  Store the new file header on disk, and flush the bitmap
+//	  For a directory, write an empty directory into the file
+//	  Add the name to the directory, and flush it to disk
 //
-//	Return TRUE if everything goes ok, otherwise, return FALSE.
-//
-// 	Create fails if:
-//   		file is already in directory
-//	 	no free space for file header
-//	 	no free entry for file in directory
-//	 	no free space for data blocks for the file 
-//
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
+//	"name" -- path of the file to be created
 //	"initialSize" -- size of file to be created
+//	"isDir" -- create a directory, rather than a normal file?
 //----------------------------------------------------------------------
 
 bool
-FileSystem::Create(char *name, int initialSize)
+FileSystem::MakeEntry(char *name, int initialSize, bool isDir)
 {
-    Directory *directory;
+    OpenFile *dirFile;
+    Directory *dir;
     BitMap *freeMap;
     FileHeader *hdr;
-    int sector;
+    char leaf[FileNameMaxLen + 1];
+    int dirSector, sector;
     bool success;
 
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    if (!Resolve(name, leaf, &dirSector) || leaf[0] == '\0')
+	return FALSE;			// no directory to put it in
+    FetchDir(dirSector, &dirFile, &dir);
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
-    if (directory->Find(name) != -1)
+    if (dir->Find(leaf) != -1)
       success = FALSE;			// file is already in directory
     else {	
         freeMap = new BitMap(NumSectors);
@@ -193,27 +304,86 @@ FileSystem::Create(char *name, int initialSize)
         sector = freeMap->Find();	// find a sector to hold the file header
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = FALSE;	// no space in directory
 	else {
     	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
+	    if (!hdr->Allocate(freeMap,
+			isDir ? (int) DirectoryFileSize : initialSize))
             	success = FALSE;	// no space on disk for data
 	    else {	
 	    	success = TRUE;
-		// everthing worked, flush all changes back to disk
+		// everthing worked, flush all changes back to disk; the
+		// bitmap goes first, as growing the directory file
+		// allocates from the copy on disk
     	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
     	    	freeMap->WriteBack(freeMapFile);
+		if (isDir) {
+		    OpenFile *newFile = new OpenFile(sector);
+		    Directory *newDir = new Directory(NumDirEntries);
+
+		    newDir->WriteBack(newFile);
+		    delete newDir;
+		    delete newFile;
+		}
+		dir->Add(leaf, sector, isDir);
+    	    	if (!dir->WriteBack(dirFile)) {
+		    success = FALSE;	// no space to grow the directory
+		    dir->Remove(leaf);
+		    hdr->Deallocate(freeMap);
+		    freeMap->Clear(sector);
+		    freeMap->WriteBack(freeMapFile);
+		}
 	    }
             delete hdr;
 	}
         delete freeMap;
     }
-    delete directory;
     return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::Create
+// 	Create a file in the Nachos file system (similar to UNIX create).
+//	Since we can't increase the size of files dynamically, we have
+//	to give Create the initial size of the file.
+//
+//	Return TRUE if everything goes ok, otherwise, return FALSE.
+//
+// 	Create fails if:
+//   		file is already in directory
+//		a directory on the path doesn't exist
+//	 	no free space for file header
+//	 	no free space to grow the directory
+//	 	no free space for data blocks for the file 
+//
+// 	Note that this implementation assumes there is no concurrent access
+//	to the file system!
+//
+//	"name" -- path of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Create(char *name, int initialSize)
+{
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    return MakeEntry(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Mkdir
+// 	Create an empty directory (UNIX mkdir).  Return TRUE if
+//	everything goes ok; it fails for the same reasons as Create.
+//
+//	"name" -- path of the directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Mkdir(char *name)
+{
+    DEBUG('f', "Creating directory %s\n", name);
+    return MakeEntry(name, 0, TRUE);
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Open
 // 	Open a file for reading and writing.  
@@ -221,22 +391,25 @@ FileSystem::Create(char *name, int initialSize)
 //	  Find the location of the file's header, using the directory 
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
+    OpenFile *dirFile;
+    Directory *dir;
     OpenFile *openFile = NULL;
-    int sector;
+    char leaf[FileNameMaxLen + 1];
+    int dirSector, sector;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
-    if (sector >= 0) 		
+    if (!Resolve(name, leaf, &dirSector))
+	return NULL;
+    FetchDir(dirSector, &dirFile, &dir);
+    sector = dir->Find(leaf); 
+    if (sector >= 0 && !dir->IsDir(leaf))
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
     return openFile;				// return NULL if not found
 }
 
@@ -249,24 +422,26 @@ FileSystem::Open(char *name)
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system.  Directories are removed with Rmdir.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name)
 { 
-    Directory *directory;
+    OpenFile *dirFile;
+    Directory *dir;
     BitMap *freeMap;
     FileHeader *fileHdr;
-    int sector;
+    char leaf[FileNameMaxLen + 1];
+    int dirSector, sector;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
-       delete directory;
+    if (!Resolve(name, leaf, &dirSector))
+	return FALSE;
+    FetchDir(dirSector, &dirFile, &dir);
+    sector = dir->Find(leaf);
+    if (sector == -1 || dir->IsDir(leaf)) {
        return FALSE;			 // file not found 
     }
     fileHdr = new FileHeader;
@@ -277,16 +452,100 @@ FileSystem::Remove(char *name)
 
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
+    dir->Remove(leaf);
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
+    dir->WriteBack(dirFile);			// flush to disk
     delete fileHdr;
-    delete directory;
     delete freeMap;
     return TRUE;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Rmdir
+// 	Delete an empty directory (UNIX rmdir).  Return TRUE if it was
+//	deleted, FALSE if it wasn't there, wasn't a directory, or still
+//	had files in it.
+//
+//	"name" -- the path of the directory to be removed
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Rmdir(char *name)
+{
+    OpenFile *dirFile;
+    Directory *dir;
+    BitMap *freeMap;
+    FileHeader *fileHdr;
+    char leaf[FileNameMaxLen + 1];
+    int dirSector, sector;
+
+    DEBUG('f', "Removing directory %s\n", name);
+    if (!Resolve(name, leaf, &dirSector))
+	return FALSE;
+    FetchDir(dirSector, &dirFile, &dir);
+    if (!dir->IsDir(leaf))
+	return FALSE;			// not found, or not a directory
+    sector = dir->Find(leaf);
+
+    FetchDir(sector, &dirFile, &dir);
+    if (dir->NumUsing() > 0)
+	return FALSE;			// not empty
+    ForgetDir(sector);
+    FetchDir(dirSector, &dirFile, &dir);
+
+    fileHdr = new FileHeader;
+    fileHdr->FetchFrom(sector);
+
+    freeMap = new BitMap(NumSectors);
+    freeMap->FetchFrom(freeMapFile);
+
+    fileHdr->Deallocate(freeMap);  		// remove data blocks
+    freeMap->Clear(sector);			// remove header block
+    dir->Remove(leaf);
+
+    freeMap->WriteBack(freeMapFile);		// flush to disk
+    dir->WriteBack(dirFile);			// flush to disk
+    delete fileHdr;
+    delete freeMap;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ReadDir
+// 	Read the entries of a directory one at a time (UNIX readdir).
+//	Get the first entry in use at or after "position"; to read the
+//	next one, call again with the position returned plus one.
+//
+//	Return the position of the entry, or -1 if there are no more
+//	entries, or "name" is not a directory.
+//
+//	"name" -- the path of the directory; "/" is the root
+//	"position" -- where in the directory to start looking
+//	"entryName" -- set to the name of the entry found; must have
+//		room for FileNameMaxLen + 1 characters
+//	"isDir" -- set to whether the entry is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::ReadDir(char *name, int position, char *entryName, bool *isDir)
+{
+    OpenFile *dirFile;
+    Directory *dir;
+    char leaf[FileNameMaxLen + 1];
+    int dirSector;
+
+    if (!Resolve(name, leaf, &dirSector))
+	return -1;
+    FetchDir(dirSector, &dirFile, &dir);
+    if (leaf[0] != '\0') {
+	if (!dir->IsDir(leaf))
+	    return -1;
+	FetchDir(dir->Find(leaf), &dirFile, &dir);
+    }
+    return dir->ReadEntry(position, entryName, isDir);
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
 // 	List all the files in the file system directory.
@@ -295,11 +554,7 @@ FileSystem::Remove(char *name)
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
-    directory->List();
-    delete directory;
+    directory->List("");
 }
 
 //----------------------------------------------------------------------
@@ -318,7 +573,6 @@ FileSystem::Print()
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
     BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
 
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -331,13 +585,11 @@ FileSystem::Print()
     freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
 
-    directory->FetchFrom(directoryFile);
     directory->Print();
 
     delete bitHdr;
     delete dirHdr;
     delete freeMap;
-    delete directory;
 }
 
 //----------------------------------------------------------------------
@@ -350,15 +602,13 @@ FileSystem::Print()
 //    total bytes of normal files
 //    bytes used by normal files(including internal fragments)
 //    bytes used by internal fragments(caused by normal files)
+//    layout of normal files: extents, and average seek distance
 //----------------------------------------------------------------------
 //新增统计磁盘信息的方法
 void 
 FileSystem::PrintInfo(){  
     BitMap *freeMap=new BitMap(NumSectors);
     freeMap->FetchFrom(freeMapFile);
-    Directory *directory = new Directory(NumDirEntries);
-    //NumDirEntries：目录的最大文件数
-    directory->FetchFrom(directoryFile);
 
     //总体大小
     int totalSize=NumSectors*SectorSize;
@@ -374,7 +624,14 @@ FileSystem::PrintInfo(){
     int normalSectors=directory->SectorStat(false);
     int allBytes=normalSectors*SectorSize;
     int fragmentedSectors=directory->SectorStat(true);
-    printf("Size used by %d normal files:\n\twithout internal fragments: %d Bytes\n",directory->NumUsing(),idealBytes);
+    printf("Size used by %d normal files:\n\twithout internal fragments: %d Bytes\n",directory->NumFiles(),idealBytes);
     printf("\tactually used: %d Bytes in %d Sectors\n",allBytes,normalSectors);
     printf("\tfragmented: %d Bytes in %d Sectors\n",allBytes-idealBytes,fragmentedSectors);
+
+    //文件的布局：连续区段数、寻道距离
+    int extents,scattered,seekTracks,steps;
+    directory->LayoutStat(&extents,&scattered,&seekTracks,&steps);
+    printf("Layout of normal files:\n\textents: %d, files in more than one extent: %d\n",extents,scattered);
+    printf("\taverage seek between consecutive sectors: %.2f tracks\n",
+        steps?(double)seekTracks/steps:0.0);
 }
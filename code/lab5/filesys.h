@@ -20,10 +20,10 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
-//	In addition, there is a bitmap for allocating
+//	in the file system.  There is a "root" directory, listing the
+//	files at the top of the file system; as in UNIX, some of these
+//	can be directories in turn, and files are named by a path such
+//	as "/a/b/c" (the leading "/" is optional).  In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
 //	bootstrap problem when the simulated disk is initialized. 
@@ -65,6 +65,13 @@ class FileSystem {
 };
 
 #else // FILESYS
+class Directory;
+
+// Sub-directories that have been looked up recently are kept in memory,
+// so that resolving a path does not read every directory along it.
+
+#define DirCacheSize		8	// # of directories in the cache
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -81,6 +88,13 @@ class FileSystem {
 
     bool Remove(char *name);  		// Delete a file (UNIX unlink)
 
+    bool Mkdir(char *name);		// Create an empty directory
+    bool Rmdir(char *name);		// Delete an empty directory
+    int ReadDir(char *name, int position, char *entryName, bool *isDir);
+					// Get the first entry at or after
+					// "position" in a directory; return
+					// where it is, or -1 if no more
+
     void List();			// List all the files in the file system
 
     void Print();			// List all the files and their contents
@@ -92,6 +106,27 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   Directory* directory;		// In-memory copy of the root
+					// directory, written back to
+					// directoryFile on every change
+
+   int dirCacheSector[DirCacheSize];	// header sector of each cached
+					// sub-directory, or -1 if none
+   OpenFile* dirCacheFile[DirCacheSize]; // the sub-directory file, and
+   Directory* dirCacheDir[DirCacheSize]; // its in-memory copy
+   int dirCacheUsed[DirCacheSize];	// when each was last looked up
+   int dirCacheClock;			// # of look ups so far
+
+   void FetchDir(int sector, OpenFile **file, Directory **dir);
+					// Find the directory whose header
+					// is at "sector", from the cache
+					// or from disk
+   void ForgetDir(int sector);		// Drop a directory from the cache
+   bool Resolve(char *name, char *leaf, int *dirSector);
+					// Find the directory holding the
+					// last component of the path "name"
+   bool MakeEntry(char *name, int initialSize, bool isDir);
+					// Create a file or directory
 };
 
 #endif // FILESYS
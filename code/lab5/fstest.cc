@@ -284,6 +284,26 @@ Print(char *name)
     return;
 }
 
+//----------------------------------------------------------------------
+// ListDir
+// 	Print the entries of the Nachos directory "name", one at a time,
+//	with a "/" after the names of sub-directories.
+//----------------------------------------------------------------------
+
+void
+ListDir(char *name)
+{
+    char entryName[FileNameMaxLen + 1];
+    bool isDir;
+    int position = 0;
+
+    while ((position = fileSystem->ReadDir(name, position, entryName,
+							&isDir)) != -1) {
+	printf("%s%s\n", entryName, isDir ? "/" : "");
+	position++;
+    }
+}
+
 //----------------------------------------------------------------------
 // PerformanceTest
 // 	Stress the Nachos file system by creating a large file, writing
@@ -308,7 +328,7 @@ FileWrite()
     int i, numBytes;
 
     printf("Sequential write of %d byte file, in %d byte chunks\n", 
-	FileSize, ContentSize);
+	FileSize, (int) ContentSize);
     if (!fileSystem->Create(FileName, 0)) {
       printf("Perf test: can't create %s\n", FileName);
       return;
@@ -342,7 +362,7 @@ FileRead()
     int i, numBytes;
 
     printf("Sequential read of %d byte file, in %d byte chunks\n", 
-	FileSize, ContentSize);
+	FileSize, (int) ContentSize);
 
     if ((openFile = fileSystem->Open(FileName)) == NULL) {
 	printf("Perf test: unable to open file %s\n", FileName);
@@ -375,4 +395,3 @@ PerformanceTest()
     }
     stats->Print();
 }
-
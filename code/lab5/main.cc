@@ -9,15 +9,26 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
+//		-sp <fifo|priority|heap|mlfq> -sq <quantum,...> -sb <period>
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-f -bc <# cache sectors> -wb -ds <fifo|scan|clook>
+//		-cp <unix file> <nachos file>
+//		-p <nachos file> -r <nachos file> -l -D -t -tc <# threads>
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sp sets the order ready threads run in: fifo (the default), or
+//	lowest priority # first, from a bitmap of per-priority queues
+//	(priority) or from a heap (heap), or from a multi-level feedback
+//	queue (mlfq), in which a thread moves down a level each time it
+//	uses up its quantum, and back to the top when woken up by a device
+//    -sq sets the quantum of each level of the feedback queue, in timer
+//	interrupts, from the top (default 1,2,4,8)
+//    -sb sets the # of timer interrupts between moving every thread back
+//	up to the top level (default 50)
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
@@ -27,12 +38,18 @@
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -bc sets the size of the disk buffer cache (0 turns it off)
+//    -wb makes the buffer cache write-back rather than write-through
+//    -ds sets the order in which queued disk requests are served
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
 //    -l lists the contents of the Nachos directory
+//    -mkdir creates a Nachos directory, -rmdir removes an empty one
+//    -ls lists the entries of one Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -tc tests the disk with several threads reading files at once
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -59,6 +76,8 @@ extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Append(char *unixFile, char *nachosFile, int half);
 extern void NAppend(char *nachosFileFrom, char *nachosFileTo);
 extern void Print(char *file), PerformanceTest(void);
+extern void ListDir(char *name);
+extern void ConcurrentTest(int numThreads);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
 
@@ -143,10 +162,26 @@ main(int argc, char **argv)
 	    argCount = 2;
 	} else if (!strcmp(*argv, "-l")) {	// list Nachos directory
             fileSystem->List();
+	} else if (!strcmp(*argv, "-mkdir")) {	// make Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->Mkdir(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-rmdir")) {	// remove Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->Rmdir(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ls")) {	// list one Nachos directory
+	    ASSERT(argc > 1);
+	    ListDir(*(argv + 1));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-D")) {	// print entire filesystem
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-tc")) {	// concurrent read test
+	    ASSERT(argc > 1);
+	    ConcurrentTest(atoi(*(argv + 1)));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-DI")){	// 新增DI指令 打印磁盘信息  print disk info 
 			fileSystem->PrintInfo();
 	}
@@ -21,15 +21,18 @@
 // 	Open a Nachos file for reading and writing.  Bring the file header
 //	into memory while the file is open.
 //
-//	"sector" -- the location on disk of the file header for this file
+//	"hdrSector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
-OpenFile::OpenFile(int sector)
+OpenFile::OpenFile(int hdrSector)
 { 
     hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    hdr->FetchFrom(hdrSector);
     seekPosition = 0;
-    this->sector=sector;
+    nextPosition = 0;
+    readAhead = 0;
+    prefetched = -1;
+    sector=hdrSector;
 }
 
 //----------------------------------------------------------------------
@@ -97,7 +100,10 @@ OpenFile::Write(char *into, int numBytes)
 //
 //	For ReadAt:
 //	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   request, but we only copy the part we are interested in.  If the
+//	   request starts where the last one ended, the file is being read
+//	   sequentially: once we get to the last sector we read ahead, we
+//	   read ahead twice as many more (up to MaxReadAhead) along with it.
 //	For WriteAt:
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
@@ -113,9 +119,48 @@ OpenFile::Write(char *into, int numBytes)
 
 int
 OpenFile::ReadAt(char *into, int numBytes, int position)
+{
+    int fileLength = hdr->FileLength();
+    int lastSector, ahead = 0;
+
+    if (position != nextPosition) {		// random access
+	readAhead = 0;
+	prefetched = -1;
+    } else if ((numBytes > 0) && (position < fileLength)) {
+	if (position + numBytes > fileLength)
+	    lastSector = divRoundDown(fileLength - 1, SectorSize);
+	else
+	    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
+	if (lastSector >= prefetched) {
+	    if (readAhead == 0)
+		readAhead = 1;
+	    else if (2 * readAhead <= MaxReadAhead)
+		readAhead *= 2;
+	    ahead = divRoundUp(fileLength, SectorSize) - 1 - lastSector;
+	    if (ahead > readAhead)
+		ahead = readAhead;
+	    prefetched = lastSector + ahead;
+	}
+    }
+    numBytes = ReadRange(into, numBytes, position, ahead);
+    nextPosition = position + numBytes;
+    return numBytes;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadRange
+// 	Read a portion of a file, starting at "position", and read
+//	"ahead" more sectors of the file into the buffer cache.  All the
+//	sectors go to the disk as one batch (see SynchDisk::ReadSectors).
+//	Return the number of bytes read into "into".
+//----------------------------------------------------------------------
+
+int
+OpenFile::ReadRange(char *into, int numBytes, int position, int ahead)
 {
     int fileLength = hdr->FileLength();
     int i, firstSector, lastSector, numSectors;
+    int *sectors;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
@@ -131,9 +176,11 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 
     // read in all the full and partial sectors that we need
     buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+    sectors = new int[numSectors + ahead];
+    for (i = 0; i < numSectors + ahead; i++)
+	sectors[i] = hdr->ByteToSector((firstSector + i) * SectorSize);
+    synchDisk->ReadSectors(sectors, numSectors, buf, ahead);
+    delete [] sectors;
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
@@ -169,10 +216,10 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
 // read in first and last sector, if they are to be partially modified
     if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
+        ReadRange(buf, SectorSize, firstSector * SectorSize, 0);
     if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+        ReadRange(&buf[(lastSector - firstSector) * SectorSize], 
+				SectorSize, lastSector * SectorSize, 0);
 
 // copy in the bytes we want to change 
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
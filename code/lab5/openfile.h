@@ -61,6 +61,9 @@ class OpenFile {
 #else // FILESYS
 class FileHeader;
 
+#define MaxReadAhead	16	// most sectors to read ahead of a
+				// sequential reader
+
 class OpenFile {
   public:
     OpenFile(int sector);		// Open a file whose header is located
@@ -80,6 +83,9 @@ class OpenFile {
     					// Read/write bytes from the file,
 					// bypassing the implicit position.
     int WriteAt(char *from, int numBytes, int position);
+					// ReadAt detects sequential access,
+					// and then reads ahead into the
+					// disk buffer cache
 
     int Length(); 			// Return the number of bytes in the
 					// file (this interface is simpler 
@@ -92,6 +98,14 @@ class OpenFile {
   private:
     FileHeader *hdr;			// Header for this file 
     int seekPosition;			// Current position within the file
+    int nextPosition;			// Where a sequential read would
+					// carry on from
+    int readAhead;			// # of sectors read ahead last time
+    int prefetched;			// Last sector of the file read ahead
+
+    int ReadRange(char *into, int numBytes, int position, int ahead);
+					// Read bytes, and "ahead" sectors
+					// past them into the cache
 		int sector;
 };
 
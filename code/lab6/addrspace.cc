@@ -20,8 +20,9 @@
 #include "addrspace.h"
 #include "noff.h"
 
-BitMap *AddrSpace::freeMap=new BitMap(NumPhysPages);
+BitMap *AddrSpace::freeMap=NULL;//created with the first space, once the machine (and its size) exists
 BitMap *AddrSpace::spaceIdMap=new BitMap(NumProcess);
+SharedPage *AddrSpace::sharedPages[SharedHashSize];
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -45,6 +46,88 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+//----------------------------------------------------------------------
+// SegmentBytes
+// 	Return how many bytes of segment "seg" lie in page "vPage", and
+//	if "executable" is not NULL, copy them from it into "frame" (the
+//	page's place in main memory).
+//----------------------------------------------------------------------
+
+static int
+SegmentBytes(Segment *seg, int vPage, char *frame, OpenFile *executable)
+{
+    int start = vPage * PageSize, end = start + PageSize;
+
+    if (seg->size <= 0)
+	return 0;
+    if (seg->virtualAddr > start)
+	start = seg->virtualAddr;
+    if (seg->virtualAddr + seg->size < end)
+	end = seg->virtualAddr + seg->size;
+    if (start >= end)
+	return 0;
+    if (executable != NULL)
+	executable->ReadAt(&frame[start - vPage * PageSize], end - start,
+			seg->inFileAddr + start - seg->virtualAddr);
+    return end - start;
+}
+
+//----------------------------------------------------------------------
+// SharedHash
+// 	Return the bucket of the shared page table that page "vPage" of
+//	the executable "fileName" goes in.
+//----------------------------------------------------------------------
+
+static int
+SharedHash(char *fileName, int vPage)
+{
+    unsigned int hash = vPage;
+
+    for (char *c = fileName; *c != '\0'; c++)
+	hash = hash * 31 + *c;
+    return hash % SharedHashSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindShared
+// 	Return the shared page "vPage" of the executable "fileName", or
+//	NULL if it is not in memory.
+//----------------------------------------------------------------------
+
+SharedPage *
+AddrSpace::FindShared(char *fileName, int vPage)
+{
+    for (SharedPage *page = sharedPages[SharedHash(fileName, vPage)];
+			page != NULL; page = page->next)
+	if (page->virtualPage == vPage && !strcmp(page->fileName, fileName))
+	    return page;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseShared
+// 	An address space has stopped mapping "page".  Once no space
+//	maps it, forget it, and free its frame unless the last space is
+//	keeping it ("keepFrame").
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReleaseShared(SharedPage *page, bool keepFrame)
+{
+    SharedPage **link = &sharedPages[SharedHash(page->fileName,
+						page->virtualPage)];
+
+    if (--page->refs > 0)
+	return;
+    while (*link != page)
+	link = &(*link)->next;
+    *link = page->next;
+    if (!keepFrame)
+	freeMap->Clear(page->frame);
+    delete [] page->fileName;
+    delete page;
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -53,17 +136,23 @@ SwapHeader (NoffHeader *noffH)
 //
 //	Assumes that the object code file is in NOFF format.
 //
-//	First, set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	Pages that hold nothing but code and initialized data are looked
+//	up among the pages already loaded from "fileName" by other
+//	spaces, and mapped read-only to the same frame if found (or
+//	loaded into a new frame and shared from then on).  The other
+//	pages get frames of their own, zeroed before the part of the
+//	segments in them is copied in.
 //
 //	"executable" is the file containing the object code to load into memory
+//	"fileName" is its name, to find pages loaded from it before
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *executable, char *fileName)
 {
     NoffHeader noffH;
     unsigned int i, size;
+    if(freeMap==NULL)
+        freeMap=new BitMap(NumPhysPages);
 
     //allocate spaceId
     ASSERT(spaceIdMap->NumClear()>0);
@@ -82,57 +171,52 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
+    ASSERT(numPages <= (unsigned) NumPhysPages);	// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
-// first, set up the translation 
+// set up the translation, and load each page
     pageTable = new TranslationEntry[numPages];
-    ASSERT(freeMap->NumClear()>=numPages);//ensure to have enough physical pages
+    shared = new SharedPage*[numPages];
     for (i = 0; i < numPages; i++) {
+	bool fromFile = (SegmentBytes(&noffH.code, i, NULL, NULL)
+		+ SegmentBytes(&noffH.initData, i, NULL, NULL) == PageSize);
+
 	pageTable[i].virtualPage = i;
-	pageTable[i].physicalPage = freeMap->Find();//lab6: could be different from vPage
-	pageTable[i].valid = TRUE;
 	pageTable[i].use = FALSE;
 	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
-					// pages to be read-only
-    bzero(&(machine->mainMemory[pageTable[i].physicalPage*PageSize]),PageSize);
-    }
-    
-
-// then, copy in the code and data segments into memory
-    if (noffH.code.size > 0) {
-        Segment seg=noffH.code;
-        int startPos=seg.virtualAddr;
-        int endPos=startPos+seg.size;
-        int firstVPage=startPos/PageSize,lastVPage=divRoundUp(endPos,PageSize);
-        int curAddr=seg.inFileAddr;//read from this addr of file
-        for(int vPage=firstVPage;vPage<=lastVPage;vPage++){
-            int pagePos=pageTable[vPage].physicalPage*PageSize;//physical pos
-            if(vPage==firstVPage)pagePos+=startPos%PageSize;
-            int curSize=(vPage==lastVPage?(endPos%PageSize):PageSize)-(vPage==firstVPage?(startPos%PageSize):0);//size
-            executable->ReadAt(&machine->mainMemory[pagePos],curSize,curAddr);
-            curAddr+=curSize;
-        }
-    }
-    if (noffH.initData.size > 0) {
-        Segment seg=noffH.initData;
-        int startPos=seg.virtualAddr;
-        int endPos=startPos+seg.size;
-        int firstVPage=startPos/PageSize,lastVPage=divRoundUp(endPos,PageSize);
-        int curAddr=seg.inFileAddr;//read from this addr of file
-        for(int vPage=firstVPage;vPage<=lastVPage;vPage++){
-            int pagePos=pageTable[vPage].physicalPage*PageSize;//physical pos
-            if(vPage==firstVPage)pagePos+=startPos%PageSize;
-            int curSize=(vPage==lastVPage?(endPos%PageSize):PageSize)-(vPage==firstVPage?(startPos%PageSize):0);//size
-            executable->ReadAt(&machine->mainMemory[pagePos],curSize,curAddr);
-            curAddr+=curSize;
-        }
+	pageTable[i].readOnly = fromFile;	// shared until written
+	pageTable[i].valid = TRUE;
+	shared[i] = fromFile ? FindShared(fileName, i) : NULL;
+	if (shared[i] != NULL) {		// already loaded
+	    shared[i]->refs++;
+	    pageTable[i].physicalPage = shared[i]->frame;
+	    continue;
+	}
+
+	pageTable[i].physicalPage = freeMap->Find();//lab6: could be different from vPage
+	ASSERT(pageTable[i].physicalPage != -1);	// out of memory
+	char *frame = &(machine->mainMemory[pageTable[i].physicalPage*PageSize]);
+	bzero(frame, PageSize);
+	SegmentBytes(&noffH.code, i, frame, executable);
+	SegmentBytes(&noffH.initData, i, frame, executable);
+	machine->InvalidateDecodeCache(pageTable[i].physicalPage);
+
+	if (fromFile) {				// share it from now on
+	    int bucket = SharedHash(fileName, i);
+
+	    shared[i] = new SharedPage;
+	    shared[i]->fileName = new char[strlen(fileName) + 1];
+	    strcpy(shared[i]->fileName, fileName);
+	    shared[i]->virtualPage = i;
+	    shared[i]->frame = pageTable[i].physicalPage;
+	    shared[i]->refs = 1;
+	    shared[i]->next = sharedPages[bucket];
+	    sharedPages[bucket] = shared[i];
+	}
     }
 
     Print();
@@ -141,14 +225,49 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space, giving back its frames.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-    for(int i=0;i<numPages;i++)freeMap->Clear(pageTable[i].physicalPage);
+    for(unsigned int i=0;i<numPages;i++)
+        if(shared[i]!=NULL)ReleaseShared(shared[i],FALSE);
+        else freeMap->Clear(pageTable[i].physicalPage);
     spaceIdMap->Clear(spaceId);
    delete [] pageTable;
+   delete [] shared;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Called on a ReadOnlyException at vPage.  If the page is shared,
+//	give this space a copy of it that it can write (or, if no other
+//	space maps it any more, just take the frame over), and return
+//	TRUE so that the instruction is retried.  Return FALSE if the
+//	page is not a shared one.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(int vPage)
+{
+    if (vPage < 0 || vPage >= (int)numPages || shared[vPage] == NULL)
+	return FALSE;
+    if (shared[vPage]->refs > 1) {
+	int frame = freeMap->Find();
+
+	ASSERT(frame != -1);			// out of memory
+	bcopy(&(machine->mainMemory[shared[vPage]->frame*PageSize]),
+		&(machine->mainMemory[frame*PageSize]), PageSize);
+	machine->InvalidateDecodeCache(frame);
+	pageTable[vPage].physicalPage = frame;
+	ReleaseShared(shared[vPage], FALSE);
+    } else					// the last user: take it
+	ReleaseShared(shared[vPage], TRUE);
+    shared[vPage] = NULL;
+    pageTable[vPage].readOnly = FALSE;
+    DEBUG('a', "Copy on write of page %d, now in frame %d\n", vPage,
+					pageTable[vPage].physicalPage);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -206,6 +325,7 @@ void AddrSpace::RestoreState()
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushTranslationCache();
 }
 
 
@@ -219,7 +339,7 @@ AddrSpace::Print(){
     printf("page table dump: %d pages in total\n",numPages);
     printf("============================================\n");
     printf("\tVirtPage, \tPhysPage\n");
-    for(int i=0;i<numPages;i++)
+    for(unsigned int i=0;i<numPages;i++)
         printf("\t%d, \t\t%d\n",pageTable[i].virtualPage,pageTable[i].physicalPage);
     printf("============================================\n");
 }
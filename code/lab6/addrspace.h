@@ -19,12 +19,30 @@
 
 #define UserStackSize		1024 	// increase this as necessary!
 #define NumProcess 256
+#define SharedHashSize 64	// # of buckets of the shared page table
+
+// A page of an executable that is in memory, and may be mapped by
+// every address space running that executable.  Only pages filled
+// entirely from the file (code and initialized data) are shared; they
+// are mapped read-only, and a space that writes one gets its own copy.
+
+class SharedPage {
+  public:
+    char *fileName;		// the executable
+    int virtualPage;		// which page of it
+    int frame;			// where it is in memory
+    int refs;			// # of address spaces mapping it
+    SharedPage *next;		// next page in the same bucket
+};
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
+    AddrSpace(OpenFile *executable, char *fileName);
+					// Create an address space,
 					// initializing it with the program
-					// stored in the file "executable"
+					// stored in the file "executable",
+					// sharing the pages already loaded
+					// from "fileName"
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -34,6 +52,9 @@ class AddrSpace {
     void RestoreState();		// info on a context switch 
     void Print(); // print state of memory
     int GetSpaceId();
+    bool CopyOnWrite(int vPage);	// A write to a read-only page: if
+					// it is shared, give this space its
+					// own copy; FALSE if it is not
 
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
@@ -41,7 +62,16 @@ class AddrSpace {
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
     int spaceId;
+    SharedPage **shared;		// the shared page each vPage maps,
+					// or NULL if the page is private
     static BitMap *freeMap,*spaceIdMap; 
+    static SharedPage *sharedPages[SharedHashSize];
+					// shared pages, by file and vPage
+
+    static SharedPage *FindShared(char *fileName, int vPage);
+    static void ReleaseShared(SharedPage *page, bool keepFrame);
+					// An address space no longer maps
+					// "page"; forget it if none does
 };
 
 #endif // ADDRSPACE_H
@@ -2,6 +2,12 @@
 //	Routines to manage a bitmap -- an array of bits each of which
 //	can be either on or off.  Represented as an array of integers.
 //
+//	Find and FindRun look for clear bits a word at a time, using
+//	count-trailing-zeros to pick the bit within a word.  They still
+//	return the lowest suitable bit, as the users of the bitmap (the
+//	disk layout in particular) expect; "firstFree" only lets them
+//	skip the words at the start of the map that are known to be full.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -22,8 +28,10 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
+    numClear = numBits;
+    firstFree = 0;
 }
 
 //----------------------------------------------------------------------
@@ -46,8 +54,13 @@ BitMap::~BitMap()
 void
 BitMap::Mark(int which) 
 { 
+    unsigned int bit = 1u << (which % BitsInWord);
+
     ASSERT(which >= 0 && which < numBits);
-    map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    if (!(map[which / BitsInWord] & bit)) {
+	map[which / BitsInWord] |= bit;
+	numClear--;
+    }
 }
     
 //----------------------------------------------------------------------
@@ -60,8 +73,15 @@ BitMap::Mark(int which)
 void 
 BitMap::Clear(int which) 
 {
+    unsigned int bit = 1u << (which % BitsInWord);
+
     ASSERT(which >= 0 && which < numBits);
-    map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    if (map[which / BitsInWord] & bit) {
+	map[which / BitsInWord] &= ~bit;
+	numClear++;
+	if (which / BitsInWord < firstFree)
+	    firstFree = which / BitsInWord;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -76,12 +96,61 @@ BitMap::Test(int which)
 {
     ASSERT(which >= 0 && which < numBits);
     
-    if (map[which / BitsInWord] & (1 << (which % BitsInWord)))
+    if (map[which / BitsInWord] & (1u << (which % BitsInWord)))
 	return TRUE;
     else
 	return FALSE;
 }
 
+//----------------------------------------------------------------------
+// BitMap::NextClear
+// 	Return the number of the first clear bit at or after "which",
+//	or numBits if there is none.  Words with no clear bits are
+//	skipped whole.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextClear(int which)
+{
+    int w = which / BitsInWord;
+    unsigned int bits;
+
+    if (which >= numBits)
+	return numBits;
+    bits = ~map[w] & (~0u << (which % BitsInWord));
+    while (bits == 0) {
+	if (++w >= numWords)
+	    return numBits;
+	bits = ~map[w];
+    }
+    which = w * BitsInWord + __builtin_ctz(bits);
+    return (which < numBits) ? which : numBits;
+}
+
+//----------------------------------------------------------------------
+// BitMap::NextSet
+// 	Return the number of the first set bit at or after "which",
+//	or numBits if there is none.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextSet(int which)
+{
+    int w = which / BitsInWord;
+    unsigned int bits;
+
+    if (which >= numBits)
+	return numBits;
+    bits = map[w] & (~0u << (which % BitsInWord));
+    while (bits == 0) {
+	if (++w >= numWords)
+	    return numBits;
+	bits = map[w];
+    }
+    which = w * BitsInWord + __builtin_ctz(bits);
+    return (which < numBits) ? which : numBits;
+}
+
 //----------------------------------------------------------------------
 // BitMap::Find
 // 	Return the number of the first bit which is clear.
@@ -94,11 +163,53 @@ BitMap::Test(int which)
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    int which;
+
+    if (numClear == 0)
+	return -1;
+    which = NextClear(firstFree * BitsInWord);
+    ASSERT(which < numBits);
+    firstFree = which / BitsInWord;
+    Mark(which);
+    return which;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Return the number of the first bit of the first run of "count"
+//	clear bits.  As a side effect, set the bits.  If "boundary" is
+//	not 0, the run must fit between two multiples of it -- for
+//	instance, on one disk track.
+//
+//	Each candidate run starts at a clear bit, and if it is too short
+//	the search goes on from the next clear bit after the set bit that
+//	ended it.
+//
+//	If there is no such run, return -1.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int count, int boundary)
+{
+    int start, end;
+
+    ASSERT(count > 0);
+    if (count > numClear)
+	return -1;
+    start = NextClear(firstFree * BitsInWord);
+    while (start + count <= numBits) {
+	if ((boundary > 0) && ((start % boundary) + count > boundary)) {
+	    start = NextClear((start / boundary + 1) * boundary);
+	    continue;				// try from the next boundary
 	}
+	end = NextSet(start);
+	if (end - start >= count) {
+	    for (int i = start; i < start + count; i++)
+		Mark(i);
+	    return start;
+	}
+	start = NextClear(end);
+    }
     return -1;
 }
 
@@ -111,11 +222,7 @@ BitMap::Find()
 int 
 BitMap::NumClear() 
 {
-    int count = 0;
-
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
-    return count;
+    return numClear;
 }
 
 //----------------------------------------------------------------------
@@ -149,6 +256,15 @@ void
 BitMap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    numClear = numBits;
+    for (int i = 0; i < numWords; i++) {
+	unsigned int bits = map[i];
+
+	if ((i + 1) * BitsInWord > numBits)	// ignore bits past the end
+	    bits &= ~(~0u << (numBits - i * BitsInWord));
+	numClear -= __builtin_popcount(bits);
+    }
+    firstFree = 0;
 }
 
 //----------------------------------------------------------------------
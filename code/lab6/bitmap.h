@@ -3,7 +3,9 @@
 //	can be either on or off.
 //
 //	Represented as an array of unsigned integers, on which we do
-//	modulo arithmetic to find the bit we are interested in.
+//	modulo arithmetic to find the bit we are interested in.  Searches
+//	go a word at a time, skipping words with no clear (or set) bits,
+//	and the number of clear bits is kept up to date as bits change.
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -43,7 +45,13 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindRun(int count, int boundary);
+				// Find "count" clear bits in a row, not
+				// crossing a multiple of "boundary" (if
+				// not 0), and set them.  Return the first
+				// one, or -1 if there is no such run.
     int NumClear();		// Return the number of clear bits
+				// (kept as bits change, so this is cheap)
 
     void Print();		// Print contents of bitmap
     
@@ -59,6 +67,14 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+    int numClear;			// number of clear bits
+    int firstFree;			// no clear bits in the words before
+					// this one
+
+    int NextClear(int which);		// First clear bit at or after
+					// "which", or numBits if none
+    int NextSet(int which);		// First set bit at or after
+					// "which", or numBits if none
 };
 
 #endif // BITMAP_H
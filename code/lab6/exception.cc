@@ -83,6 +83,9 @@ ExceptionHandler(ExceptionType which)
 	            ASSERT(FALSE);
             }
         }
+    } else if (which == ReadOnlyException && currentThread->space->
+		CopyOnWrite(machine->ReadRegister(BadVAddrReg) / PageSize)) {
+	return;			// retry the write, on the page's own copy
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
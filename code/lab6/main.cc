@@ -9,7 +9,9 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-sp <fifo|priority|heap|mlfq> -sq <quantum,...> -sb <period>
+//		-s -bb -ff -np <# pages> -ps <page size>
+//		-x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -e <network orderability>
@@ -19,10 +21,23 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sp sets the order ready threads run in: fifo (the default), or
+//	lowest priority # first, from a bitmap of per-priority queues
+//	(priority) or from a heap (heap), or from a multi-level feedback
+//	queue (mlfq), in which a thread moves down a level each time it
+//	uses up its quantum, and back to the top when woken up by a device
+//    -sq sets the quantum of each level of the feedback queue, in timer
+//	interrupts, from the top (default 1,2,4,8)
+//    -sb sets the # of timer interrupts between moving every thread back
+//	up to the top level (default 50)
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs a basic block at a time, as threaded code
+//    -ff only checks for interrupts when one is due (same simulated time)
+//    -np, -ps set the number of physical pages and the page size of the
+//	simulated machine
 //    -x runs a user program
 //    -c tests the console
 //
@@ -18,10 +18,213 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
-#include "noff.h"
 
-BitMap *AddrSpace::freeMap=new BitMap(NumPhysPages);
+CoreMap *AddrSpace::coreMap=NULL;//created with the first space, once the machine (and its size) exists
 BitMap *AddrSpace::spaceIdMap=new BitMap(NumProcess);
+ReplacePolicy AddrSpace::policy=ReplaceFIFO;
+int AddrSpace::frameQuota=NumUserProcessFrame;
+int AddrSpace::swapCluster=1;
+int AddrSpace::workingSetWindow=0;
+TLBPolicy AddrSpace::tlbPolicy=TLBRandom;
+PageTableKind AddrSpace::pageTableKind=LinearTable;
+bool AddrSpace::measurePageTables=FALSE;
+int AddrSpace::virtualPages=0;
+InvertedPageTable *AddrSpace::invertedTable=NULL;
+AddrSpace *AddrSpace::spaces[NumProcess];
+List *AddrSpace::swappedSpaces=new List;
+
+//----------------------------------------------------------------------
+// CoreMap::CoreMap
+// 	Initialize the core map, with every frame free.
+//
+//	"frames" -- the number of frames of physical memory
+//	"replacePolicy" -- how to choose a page to evict
+//	"spaceQuota" -- how many frames each address space may hold, or 0
+//		to let any space take frames from any other
+//----------------------------------------------------------------------
+
+CoreMap::CoreMap(int frames, ReplacePolicy replacePolicy, int spaceQuota)
+{
+    numFrames = frames;
+    policy = replacePolicy;
+    quota = spaceQuota;
+    freeFrames = new BitMap(numFrames);
+    owner = new AddrSpace*[numFrames];
+    virtPage = new int[numFrames];
+    loadTime = new int[numFrames];
+    age = new unsigned char[numFrames];
+    for (int i = 0; i < numFrames; i++)
+	owner[i] = NULL;
+    framesOf = new int[NumProcess];
+    for (int i = 0; i < NumProcess; i++)
+	framesOf[i] = 0;
+    loads = 0;
+    hand = 0;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::~CoreMap
+// 	De-allocate the core map.
+//----------------------------------------------------------------------
+
+CoreMap::~CoreMap()
+{
+    delete freeFrames;
+    delete [] owner;
+    delete [] virtPage;
+    delete [] loadTime;
+    delete [] age;
+    delete [] framesOf;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Entry
+// 	Return the page table entry of the page in "frame".
+//----------------------------------------------------------------------
+
+TranslationEntry *
+CoreMap::Entry(int frame)
+{
+    return owner[frame]->GetEntry(virtPage[frame]);
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Candidate
+// 	Return TRUE if "frame" holds a page that may be evicted to make
+//	room for a page of "space"; any page, if "space" is NULL.
+//----------------------------------------------------------------------
+
+bool
+CoreMap::Candidate(int frame, AddrSpace *space)
+{
+    return (bool)(owner[frame] != NULL
+		&& (space == NULL || owner[frame] == space));
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Victim
+// 	Choose a frame to empty, by the replacement policy, among the
+//	frames of "space" (or all frames, if "space" is NULL).  The use
+//	bits are cleared as the policy sees them; the machine's
+//	translation cache is flushed when the page fault returns, so
+//	the next reference to each page sets its use bit again.
+//----------------------------------------------------------------------
+
+int
+CoreMap::Victim(AddrSpace *space)
+{
+    int victim = -1;
+
+    switch (policy) {
+      case ReplaceFIFO:
+	for (int i = 0; i < numFrames; i++)
+	    if (Candidate(i, space)
+		    && (victim == -1 || loadTime[i] < loadTime[victim]))
+		victim = i;
+	break;
+
+      case ReplaceClock:
+	for (;; hand = (hand + 1) % numFrames) {
+	    if (!Candidate(hand, space))
+		continue;
+	    if (!Entry(hand)->use)
+		break;
+	    Entry(hand)->use = FALSE;	// second chance
+	}
+	victim = hand;
+	hand = (hand + 1) % numFrames;
+	break;
+
+      case ReplaceEnhancedClock:
+	// Look for a page that is neither used nor dirty; then for one
+	// that is not used, clearing use bits on the way; and repeat,
+	// by when every use bit has been cleared.
+	for (int pass = 0; victim == -1; pass++) {
+	    ASSERT(pass < 4);
+	    for (int n = 0; n < numFrames; n++) {
+		int i = (hand + n) % numFrames;
+
+		if (!Candidate(i, space))
+		    continue;
+		if (!Entry(i)->use && (Entry(i)->dirty == (pass % 2 == 1))) {
+		    victim = i;
+		    break;
+		}
+		if (pass % 2 == 1)
+		    Entry(i)->use = FALSE;
+	    }
+	}
+	hand = (victim + 1) % numFrames;
+	break;
+
+      case ReplaceAging:
+	for (int i = 0; i < numFrames; i++)
+	    if (Candidate(i, space) && (victim == -1 || age[i] < age[victim]
+		    || (age[i] == age[victim] && loadTime[i] < loadTime[victim])))
+		victim = i;
+	break;
+    }
+    ASSERT(victim != -1);
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Allocate
+// 	Find a frame to hold page "vpn" of "space".  If the space has
+//	used up its quota, one of its own pages is evicted; otherwise a
+//	free frame is taken, and if there are none, a page of any space
+//	is evicted.
+//
+//	For aging, this is also when the use bits are sampled: each
+//	frame's counter is shifted right, with its use bit shifted in
+//	at the top.  With a TLB, the bits are first brought up to date
+//	from it.
+//----------------------------------------------------------------------
+
+int
+CoreMap::Allocate(AddrSpace *space, int vpn)
+{
+    int frame;
+
+    AddrSpace::TLBSync();
+    if (policy == ReplaceAging)
+	for (int i = 0; i < numFrames; i++)
+	    if (owner[i] != NULL) {
+		age[i] = (age[i] >> 1) | (Entry(i)->use ? 0x80 : 0);
+		Entry(i)->use = FALSE;
+	    }
+
+    if (quota > 0 && framesOf[space->GetSpaceId()] >= quota)
+	frame = Victim(space);
+    else if ((frame = freeFrames->Find()) == -1)
+	frame = Victim(NULL);
+
+    if (owner[frame] != NULL) {
+	owner[frame]->Evict(virtPage[frame]);
+	framesOf[owner[frame]->GetSpaceId()]--;
+    }
+    owner[frame] = space;
+    virtPage[frame] = vpn;
+    loadTime[frame] = loads++;
+    age[frame] = 0x80;		// it is being used now
+    framesOf[space->GetSpaceId()]++;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// CoreMap::Free
+// 	The page in "frame" is no longer needed (its address space is
+//	being deleted).
+//----------------------------------------------------------------------
+
+void
+CoreMap::Free(int frame)
+{
+    ASSERT(owner[frame] != NULL);
+    framesOf[owner[frame]->GetSpaceId()]--;
+    owner[frame] = NULL;
+    freeFrames->Clear(frame);
+}
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -48,28 +251,39 @@ SwapHeader (NoffHeader *noffH)
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
-//	Load the program from a file "executable", and set everything
-//	up so that we can start executing user instructions.
+//	Set everything up so that we can start executing user
+//	instructions from the program in the file "executable".
 //
 //	Assumes that the object code file is in NOFF format.
 //
-//	First, set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	Nothing is loaded yet: every page starts out invalid, and is
+//	brought in when it is first touched (see readIn).  The space
+//	keeps "executable" open to load code and data pages from, and
+//	closes it when it is deleted.
+//
+//	With -va the space is made at least virtualPages pages, with
+//	the stack still at the top; the pages in between are zero-filled
+//	when first touched, like bss.  A two-level or inverted page table
+//	only takes memory for the pages actually used.
 //
 //	"executable" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace(OpenFile *executable)
 {
-    NoffHeader noffH;
     unsigned int i, size;
-    pageQueue=new List();
+    if(coreMap==NULL){
+        coreMap=new CoreMap(NumPhysPages,policy,frameQuota);
+        if(pageTableKind==InvertedTable)
+            invertedTable=new InvertedPageTable(NumPhysPages);
+    }
 
 //allocate spaceId
     ASSERT(spaceIdMap->NumClear()>0);
     spaceId=spaceIdMap->Find();
     sprintf(swapFileName,"SWAP%d",spaceId);
+    swapFile=NULL;//created when a dirty page is first evicted
+    execFile=executable;
 
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -82,51 +296,46 @@ AddrSpace::AddrSpace(OpenFile *executable)
 			+ UserStackSize;	// we need to increase the size
 						// to leave room for the stack
     numPages = divRoundUp(size, PageSize);
+    if(numPages<(unsigned int)virtualPages)
+        numPages=virtualPages;
     size=numPages*PageSize;
 
-//create swap file
-    fileSystem->Remove(swapFileName);
-    fileSystem->Create(swapFileName,size);
-
-
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
    
 // first, set up the translation 
-    pageTable = new TranslationEntry[numPages];
-    for (i = 0; i < numPages; i++) {
-	pageTable[i].virtualPage = i;	
-	pageTable[i].physicalPage = -1;
-	pageTable[i].valid = FALSE;
-	pageTable[i].use = FALSE;
-	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
-					// pages to be read-only
-    }
-    
-
-
-// then, copy in the code and data segments into swap file
-    OpenFile *swapFile=fileSystem->Open(swapFileName);
-    if(swapFile==NULL){
-        printf("Unable to open swap file %s\n",swapFileName);
-        return;
+    pageTable = NULL;
+    twoLevelTable = NULL;
+    if (pageTableKind == TwoLevelTable)
+	twoLevelTable = new TwoLevelPageTable(numPages);
+    else if (pageTableKind == LinearTable) {
+	pageTable = new TranslationEntry[numPages];
+	for (i = 0; i < numPages; i++) {
+	    pageTable[i].virtualPage = i;	
+	    pageTable[i].physicalPage = -1;
+	    pageTable[i].valid = FALSE;
+	    pageTable[i].use = FALSE;
+	    pageTable[i].dirty = FALSE;
+	    pageTable[i].readOnly = FALSE;  // if the code segment was entirely
+					// on a separate page, we could set
+					// its pages to be read-only
+	    pageTable[i].asid = spaceId;
+	}
     }
-    if(noffH.code.size>0){
-        Segment seg=noffH.code;
-        char tmpBuff[seg.size];
-        executable->ReadAt(tmpBuff,seg.size,seg.inFileAddr);
-        swapFile->WriteAt(tmpBuff,seg.size,seg.virtualAddr);
+    onSwap = new BitMap(numPages);
+    lastUsed = NULL;
+    if (workingSetWindow > 0) {
+	lastUsed = new int[numPages];
+	for (i = 0; i < numPages; i++)
+	    lastUsed[i] = -1;
     }
-    if(noffH.initData.size>0){
-        Segment seg=noffH.initData;
-        char tmpBuff[seg.size];
-        executable->ReadAt(tmpBuff,seg.size,seg.inFileAddr);
-        swapFile->WriteAt(tmpBuff,seg.size,seg.virtualAddr);
-    }
-    delete swapFile;
-
+    samples=0;
+    workingSet=0;
+    swappedOut=swapOutPending=FALSE;
+    thread=NULL;
+    runStart=stats->userTicks;
+    spaces[spaceId]=this;
+    MeasurePageTables();
 
     Print();
 
@@ -139,10 +348,27 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 AddrSpace::~AddrSpace()
 {
-    for(int i=0;i<numPages;i++)freeMap->Clear(pageTable[i].physicalPage);
+    for(int i=0;i<(int)numPages;i++){
+        TranslationEntry *entry=InMemory(i);
+        if(entry!=NULL){
+            coreMap->Free(entry->physicalPage);
+            Unmap(i);//an inverted table entry outlives the space
+        }
+    }
+    for(int i=0;i<TLBSize&&machine->tlb!=NULL;i++)
+        if(machine->tlb[i].asid==spaceId)
+            machine->tlb[i].valid=FALSE;//the spaceId may be used again
+    spaces[spaceId]=NULL;
     spaceIdMap->Clear(spaceId);
    delete [] pageTable;
-   delete pageQueue;
+   delete twoLevelTable;
+   delete onSwap;
+   delete [] lastUsed;
+   delete swapFile;
+   delete execFile;
+    IntStatus oldLevel=interrupt->SetLevel(IntOff);
+    Balance();//its memory may let a suspended space back in
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -182,30 +408,49 @@ AddrSpace::InitRegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, nothing!
+//	Nothing needs saving, but the user ticks since the space got
+//	the CPU are charged to it (the statistics are printed by space id).
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() 
-{}
+{
+    stats->userTicksOf[spaceId] += stats->userTicks - runStart;
+    runStart = stats->userTicks;
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      Tell the machine where to find the page table; or, if it has a
+//	TLB, which TLB entries are ours.  Entries of other spaces stay
+//	in the TLB (they don't match), for when those spaces run again.
+//	The inverted page table is shared, and is searched by space id.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
-    machine->pageTable = pageTable;
-    machine->pageTableSize = numPages;
+    runStart = stats->userTicks;
+    machine->asid = spaceId;
+    if (machine->tlb != NULL)
+	;			// the kernel refills the TLB from our table
+    else if (pageTableKind == LinearTable) {
+	machine->pageTable = pageTable;
+	machine->pageTableSize = numPages;
+    } else if (pageTableKind == TwoLevelTable)
+	machine->twoLevelTable = twoLevelTable;
+    else
+	machine->invertedTable = invertedTable;
+    machine->FlushTranslationCache();
 }
 
 
 //----------------------------------------------------------------------
 // AddrSpace::Print
 // 	Print the state of memory, to see how program using
+//  (only the pages that have a page table entry, for a two-level or
+//  inverted table)
 //----------------------------------------------------------------------
 void
 AddrSpace::Print(){
@@ -213,8 +458,11 @@ AddrSpace::Print(){
     printf("page table dump: %d pages in total\n",numPages);
     printf("========================================================================================\n");
     printf("\tVirtPage, \tPhysPage, \tValid, \t\tUse, \t\tDirty\n");
-    for(int i=0;i<numPages;i++)
-        printf("\t%d, \t\t%d, \t\t%d, \t\t%d, \t\t%d\n",pageTable[i].virtualPage,pageTable[i].physicalPage,pageTable[i].valid,pageTable[i].use,pageTable[i].dirty);
+    for(int i=0;i<(int)numPages;i++){
+        TranslationEntry *entry=GetEntry(i);
+        if(entry!=NULL)
+            printf("\t%d, \t\t%d, \t\t%d, \t\t%d, \t\t%d\n",entry->virtualPage,entry->physicalPage,entry->valid,entry->use,entry->dirty);
+    }
     printf("========================================================================================\n");
 }
 
@@ -227,76 +475,443 @@ AddrSpace::GetSpaceId(){
     return spaceId;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	copy the part of segment seg that lies in vPage from the
+//  executable into frame (the page's frame in main memory)
+//----------------------------------------------------------------------
+void
+AddrSpace::LoadSegment(Segment *seg, int vPage, char *frame){
+    int start=vPage*PageSize,end=start+PageSize;
+    if(seg->virtualAddr>start)start=seg->virtualAddr;
+    if(seg->virtualAddr+seg->size<end)end=seg->virtualAddr+seg->size;
+    if(start<end)
+        execFile->ReadAt(&frame[start-vPage*PageSize],end-start,seg->inFileAddr+start-seg->virtualAddr);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::readIn
-// 	for active vPage, read its content from disk to its physPage
+// 	for active vPage, fill in its physPage: from the swap file if
+//  it has been written out before, and otherwise with zeros and the
+//  code and initialized data that fall in the page, straight from the
+//  executable (so bss and stack pages need no I/O at all)
 //----------------------------------------------------------------------
 void 
 AddrSpace::readIn(int newPage){
-    OpenFile *swapFile=fileSystem->Open(swapFileName);
-    if(swapFile==NULL){
-        printf("Unable to open swap file %s\n",swapFileName);
-        return;
+    int physPage=GetEntry(newPage)->physicalPage;
+    char *frame=&(machine->mainMemory[physPage*PageSize]);
+    if(onSwap->Test(newPage))
+        swapFile->ReadAt(frame,PageSize,newPage*PageSize);
+    else{
+        bzero(frame,PageSize);
+        LoadSegment(&noffH.code,newPage,frame);
+        LoadSegment(&noffH.initData,newPage,frame);
     }
-    swapFile->ReadAt(&(machine->mainMemory[pageTable[newPage].physicalPage*PageSize]),PageSize,newPage*PageSize);
-    delete swapFile;
+    machine->InvalidateDecodeCache(physPage);//frame now holds another page
     printf("vPage:%d has been read into mem\n",newPage);
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::writeOut
 // 	for vPage not active no more (replaced by the vPage algorithm),
-//  write its content from its physPage to disk
+//  write its content from its physPage to disk.
+//  Dirty neighbours still in memory are written out with it (up to
+//  swapCluster pages in all), in one write, and become clean; as
+//  vPages are laid out in order in the swap file, the run is contiguous
+//  on disk.
 //----------------------------------------------------------------------
 void
 AddrSpace::writeOut(int oldPage){
     printf("swapping out vPage:%d ...\t",oldPage);
-    if(pageTable[oldPage].dirty){
+    TranslationEntry *entry=GetEntry(oldPage),*neighbour;
+    if(entry->dirty){
         printf("Dirty! It will be written into disk\n");
-        OpenFile *swapFile=fileSystem->Open(swapFileName);
-        if(swapFile==NULL){
-            printf("Unable to open swap file %s\n",swapFileName);
-            return;
+        if(swapFile==NULL){//first page to go to swap: make the file
+            fileSystem->Remove(swapFileName);
+            fileSystem->Create(swapFileName,0);
+            swapFile=fileSystem->Open(swapFileName);
+            if(swapFile==NULL){
+                printf("Unable to open swap file %s\n",swapFileName);
+                return;
+            }
         }
-        swapFile->WriteAt(&(machine->mainMemory[pageTable[oldPage].physicalPage*PageSize]),PageSize,oldPage*PageSize);
-        stats->numPageWriteOuts++;
-        delete swapFile;
+        int first=oldPage,last=oldPage;
+        while(last-first+1<swapCluster&&first>0
+                &&(neighbour=InMemory(first-1))!=NULL&&neighbour->dirty)first--;
+        while(last-first+1<swapCluster&&last+1<(int)numPages
+                &&(neighbour=InMemory(last+1))!=NULL&&neighbour->dirty)last++;
+        if(first==last)
+            swapFile->WriteAt(&(machine->mainMemory[entry->physicalPage*PageSize]),PageSize,oldPage*PageSize);
+        else{
+            printf("\twith vPages %d-%d in one write\n",first,last);
+            char *buffer=new char[(last-first+1)*PageSize];
+            for(int i=first;i<=last;i++){
+                neighbour=GetEntry(i);
+                bcopy(&(machine->mainMemory[neighbour->physicalPage*PageSize]),&buffer[(i-first)*PageSize],PageSize);
+                neighbour->dirty=FALSE;//the copy on disk is up to date
+                TranslationEntry *cached=TLBEntry(i);
+                if(cached!=NULL)cached->dirty=FALSE;
+                onSwap->Mark(i);
+            }
+            swapFile->WriteAt(buffer,(last-first+1)*PageSize,first*PageSize);
+            delete [] buffer;
+        }
+        onSwap->Mark(oldPage);
+        stats->numPageWriteOuts+=last-first+1;
     }else{
         printf("Clean! No need to write into disk\n");
     }
 }
 
 //----------------------------------------------------------------------
-// AddrSpace::FIFO
+// AddrSpace::GetEntry
+// 	returns the page table entry of vPage, for the core map; NULL
+//  if the page table has none (a two-level table without the leaf, or
+//  an inverted table without the page in memory)
+//----------------------------------------------------------------------
+TranslationEntry *
+AddrSpace::GetEntry(int vPage){
+    int probes;
+    if(pageTableKind==LinearTable)
+        return &pageTable[vPage];
+    if(pageTableKind==TwoLevelTable)
+        return twoLevelTable->Lookup(vPage);
+    return invertedTable->Lookup(spaceId,vPage,&probes);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InMemory
+// 	returns the page table entry of vPage if it is valid (the page
+//  is in memory), or NULL
+//----------------------------------------------------------------------
+TranslationEntry *
+AddrSpace::InMemory(int vPage){
+    TranslationEntry *entry=GetEntry(vPage);
+    if(entry==NULL||!entry->valid)
+        return NULL;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RefillEntry
+// 	InMemory, for the TLB miss handler: the lookup and its probes
+//  are counted in stats, the way Machine::Translate counts them when
+//  there is no TLB, so that -pt can be compared with a TLB too.  The
+//  kernel's other lookups are bookkeeping, and are not counted.
+//----------------------------------------------------------------------
+TranslationEntry *
+AddrSpace::RefillEntry(int vPage){
+    TranslationEntry *entry;
+    int probes;
+    stats->numPageTableLookups++;
+    if(pageTableKind==LinearTable){
+        entry=&pageTable[vPage];
+        stats->numPageTableProbes++;
+    }else if(pageTableKind==TwoLevelTable){
+        entry=twoLevelTable->Lookup(vPage);
+        stats->numPageTableProbes+=(entry==NULL)?1:2;
+    }else{
+        entry=invertedTable->Lookup(spaceId,vPage,&probes);
+        stats->numPageTableProbes+=probes;
+    }
+    if(entry==NULL||!entry->valid)
+        return NULL;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Map
+// 	make vPage valid, in frame, and clean; a two-level table gets
+//  the leaf it is in, an inverted table the entry of the frame
+//----------------------------------------------------------------------
+void
+AddrSpace::Map(int vPage,int frame){
+    TranslationEntry *entry;
+    if(pageTableKind==InvertedTable){
+        invertedTable->Insert(spaceId,vPage,frame);
+        return;
+    }
+    if(pageTableKind==TwoLevelTable)
+        entry=twoLevelTable->Entry(vPage);
+    else
+        entry=&pageTable[vPage];
+    entry->physicalPage=frame;
+    entry->valid=TRUE;
+    entry->dirty=FALSE;
+    entry->readOnly=FALSE;
+    entry->asid=spaceId;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unmap
+// 	make vPage, which is in memory, invalid
+//----------------------------------------------------------------------
+void
+AddrSpace::Unmap(int vPage){
+    TranslationEntry *entry=InMemory(vPage);
+    ASSERT(entry!=NULL);
+    if(pageTableKind==InvertedTable)
+        invertedTable->Remove(entry->physicalPage);
+    else
+        entry->valid=FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MeasurePageTables
+// 	with -pt, add up the memory taken by the page tables of all the
+//  spaces (the inverted table once), and keep the peak in the stats.
+//  Called when a space is created and when a page is mapped, which is
+//  when the page tables can grow.
+//----------------------------------------------------------------------
+void
+AddrSpace::MeasurePageTables(){
+    if(!measurePageTables)
+        return;
+    int bytes=(invertedTable!=NULL)?invertedTable->Bytes():0;
+    for(int i=0;i<NumProcess;i++){
+        if(spaces[i]==NULL)
+            continue;
+        if(spaces[i]->pageTable!=NULL)
+            bytes+=spaces[i]->numPages*sizeof(TranslationEntry);
+        if(spaces[i]->twoLevelTable!=NULL)
+            bytes+=spaces[i]->twoLevelTable->Bytes();
+    }
+    if(bytes>stats->maxPageTableBytes)
+        stats->maxPageTableBytes=bytes;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Evict
+// 	the core map is taking the frame of oldPage for another page:
+//  write it out if need be, and mark it not in memory (and drop it
+//  from the TLB; its use and dirty bits have been synced already)
+//----------------------------------------------------------------------
+void
+AddrSpace::Evict(int oldPage){
+    printf("\tout:vNum: %d, physPage:%d\n",oldPage,GetEntry(oldPage)->physicalPage);
+    writeOut(oldPage);
+    Unmap(oldPage);
+    TranslationEntry *cached=TLBEntry(oldPage);
+    if(cached!=NULL)cached->valid=FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageIn
 // 	An implement for pure demand paging,
 //  called by PageFaultException, allocating a physPage for the new page.
-//  Queue implementation: existing class List
+//  The core map picks the frame, evicting a page (maybe of another
+//  space) by the replacement policy if need be.
 //----------------------------------------------------------------------
 
 void
-AddrSpace::FIFO(int newPage){
-    pageQueue->Append((void*)newPage);
-    int oldPage=-1;
-   
-    if(pageQueue->GetSize()>NumUserProcessFrame)
-        oldPage=(int)pageQueue->Remove();
+AddrSpace::PageIn(int newPage){
     printf("page swapping...\n");
     printf("\tin:vNum: %d\n",newPage);
 
-    if(oldPage!=-1){//need to swap out an old page
-        printf("\tout:vNum: %d, physPage:%d\n",oldPage,pageTable[oldPage].physicalPage);
-        writeOut(oldPage);
-        pageTable[oldPage].valid=FALSE;
-        pageTable[newPage].physicalPage=pageTable[oldPage].physicalPage;   
-    }
-    else pageTable[newPage].physicalPage=freeMap->Find();//limit not reached
-
-    pageTable[newPage].valid=TRUE;
-    pageTable[newPage].dirty=FALSE;
-    pageTable[newPage].readOnly=FALSE;
+    ASSERT(newPage>=0&&newPage<(int)numPages);//else the program is broken
+    Map(newPage,coreMap->Allocate(this,newPage));
+    if(lastUsed!=NULL)
+        lastUsed[newPage]=samples;//it is being used now
+    MeasurePageTables();
     
     readIn(newPage);
+    if(machine->tlb!=NULL)
+        TLBMiss(newPage);//save the program a TLB miss
     Print();
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::SampleWorkingSets
+// 	Called on each timer interrupt that finds a user program running
+//  (if workingSetWindow is set).  The running space's page table is
+//  scanned: a page whose use bit is set was used since the last sample,
+//  and the bit is cleared again.  The space's working set is the pages
+//  used in its last workingSetWindow samples; as only the running space
+//  is sampled, this is in its own virtual time, so a space does not
+//  lose its working set by waiting for the CPU.  Then see whether the
+//  working sets still fit in memory.
+//----------------------------------------------------------------------
+void
+AddrSpace::SampleWorkingSets(){
+    AddrSpace *space=currentThread->space;
+    if(workingSetWindow==0||space==NULL)
+        return;
+    TLBSync();
+    space->samples++;
+    space->workingSet=0;
+    for(int i=0;i<(int)space->numPages;i++){
+        TranslationEntry *entry=space->InMemory(i);
+        if(entry!=NULL&&entry->use){
+            space->lastUsed[i]=space->samples;
+            entry->use=FALSE;
+        }
+        if(space->lastUsed[i]>=0&&space->samples-space->lastUsed[i]<workingSetWindow)
+            space->workingSet++;
+    }
+    machine->FlushTranslationCache();//so the next use sets the bits again
+    Balance();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Balance
+// 	The medium-term scheduler.  If the working sets of the spaces in
+//  memory add up to more than physical memory, every space would keep
+//  faulting its pages back in (thrashing): pick the space created last
+//  to be suspended and swapped out, the next time it runs (see
+//  SwapOut).  If they leave room for the working set of the space
+//  suspended first, wake it up again; its pages fault back in as it
+//  uses them.  The last space in memory is never suspended.
+//----------------------------------------------------------------------
+void
+AddrSpace::Balance(){
+    int total=0,inMemory=0;
+    AddrSpace *victim=NULL;
+    for(int i=0;i<NumProcess;i++){
+        AddrSpace *space=spaces[i];
+        if(space==NULL||space->swappedOut)
+            continue;
+        if(space->swapOutPending)
+            return;//wait until that one is out
+        total+=space->workingSet;
+        inMemory++;
+        victim=space;
+    }
+    if(total>NumPhysPages){
+        if(inMemory>1){
+            DEBUG('a',"Working sets need %d frames, suspending space %d\n",total,victim->spaceId);
+            victim->swapOutPending=TRUE;
+        }
+    }else if(!swappedSpaces->IsEmpty()){
+        AddrSpace *next=(AddrSpace *)swappedSpaces->Remove();
+        if(total+next->workingSet<=NumPhysPages){
+            printf("SpaceId:%d swapped back in\n",next->spaceId);
+            next->swappedOut=FALSE;
+            scheduler->ReadyToRun(next->thread);
+            next->thread=NULL;
+        }else
+            swappedSpaces->Prepend(next);//still no room for it
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapOutPending
+// 	returns TRUE if the medium-term scheduler wants this space out
+//----------------------------------------------------------------------
+bool
+AddrSpace::SwapOutPending(){
+    return swapOutPending;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapOut
+// 	Suspend the running space: evict all its pages (dirty ones go to
+//  the swap file) and put its thread to sleep, until Balance finds room
+//  for its working set again.  Called by the running thread itself,
+//  between two user instructions.
+//----------------------------------------------------------------------
+void
+AddrSpace::SwapOut(){
+    ASSERT(currentThread->space==this&&swapOutPending);
+    printf("SpaceId:%d swapped out, working set %d pages\n",spaceId,workingSet);
+    TLBSync();
+    for(int i=0;i<(int)numPages;i++)
+        if(InMemory(i)!=NULL){
+            int frame=GetEntry(i)->physicalPage;
+            Evict(i);
+            coreMap->Free(frame);
+        }
+    stats->swapOutsOf[spaceId]++;
+    swapOutPending=FALSE;
+    swappedOut=TRUE;
+    thread=currentThread;
+    swappedSpaces->Append(this);
+
+    IntStatus oldLevel=interrupt->SetLevel(IntOff);
+    currentThread->Sleep();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::TLBEntry
+// 	returns the TLB entry holding vPage of this space, or NULL if
+//  there is none (or no TLB)
+//----------------------------------------------------------------------
+TranslationEntry *
+AddrSpace::TLBEntry(int vPage){
+    if(machine->tlb==NULL)
+        return NULL;
+    int first=(vPage%(TLBSize/machine->tlbWays))*machine->tlbWays;
+    for(int i=first;i<first+machine->tlbWays;i++)
+        if(machine->tlb[i].valid&&machine->tlb[i].virtualPage==vPage
+                &&machine->tlb[i].asid==spaceId)
+            return &machine->tlb[i];
+    return NULL;
+}
 
+//----------------------------------------------------------------------
+// AddrSpace::TLBSync
+// 	The machine sets the use and dirty bits of TLB entries, not of
+//  the page table entries they were loaded from.  Copy them to the
+//  page tables, so the replacement policy, the working set sampling
+//  and writeOut see them; the use bits are cleared in the TLB, so a
+//  use bit the kernel clears in a page table stays clear until the
+//  page is used again.
+//----------------------------------------------------------------------
+void
+AddrSpace::TLBSync(){
+    for(int i=0;i<TLBSize&&machine->tlb!=NULL;i++){
+        TranslationEntry *cached=&machine->tlb[i];
+        if(!cached->valid)
+            continue;
+        TranslationEntry *entry=spaces[cached->asid]->InMemory(cached->virtualPage);
+        ASSERT(entry!=NULL);//the TLB only holds pages in memory
+        entry->use=entry->use||cached->use;
+        entry->dirty=entry->dirty||cached->dirty;
+        cached->use=FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::TLBMiss
+// 	The TLB miss handler.  vPage of this space is not in the TLB: if
+//  it is in memory, load its page table entry into the TLB, in the set
+//  it belongs to, and return TRUE.  A free entry of the set is used if
+//  there is one; otherwise tlbPolicy picks one, whose bits are synced
+//  to its page table first.  Return FALSE if the page is not in memory,
+//  which is a real page fault.
+//----------------------------------------------------------------------
+bool
+AddrSpace::TLBMiss(int vPage){
+    ASSERT(vPage>=0&&vPage<(int)numPages);//else the program is broken
+    TranslationEntry *entry=RefillEntry(vPage);
+    if(entry==NULL)
+        return FALSE;
+
+    int ways=machine->tlbWays;
+    int first=(vPage%(TLBSize/ways))*ways;
+    int slot=-1;
+    for(int i=first;i<first+ways&&slot==-1;i++)
+        if(!machine->tlb[i].valid)
+            slot=i;
+    if(slot==-1){
+        if(tlbPolicy==TLBRandom)
+            slot=first+Random()%ways;
+        else{
+            slot=first;
+            for(int i=first+1;i<first+ways;i++)
+                if(machine->tlbLastUse[i]<machine->tlbLastUse[slot])
+                    slot=i;
+        }
+        TranslationEntry *old=&machine->tlb[slot];
+        TranslationEntry *oldEntry=spaces[old->asid]->InMemory(old->virtualPage);
+        ASSERT(oldEntry!=NULL);
+        oldEntry->use=oldEntry->use||old->use;
+        oldEntry->dirty=oldEntry->dirty||old->dirty;
+    }
+    DEBUG('a',"TLB miss on vPage %d of space %d, loaded into entry %d\n",vPage,spaceId,slot);
+    machine->tlb[slot]=*entry;
+    machine->tlb[slot].use=FALSE;
+    machine->tlb[slot].asid=spaceId;
+    machine->tlbLastUse[slot]=0;
+    return TRUE;
+}
@@ -17,11 +17,83 @@
 #include "filesys.h"
 #include "bitmap.h"
 #include "list.h"
+#include "noff.h"
+#include "stats.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
-#define NumProcess 256
 #define NumUserProcessFrame 5
 
+class AddrSpace;
+class Thread;
+
+// How the core map picks a page to throw out of memory.
+
+enum ReplacePolicy {
+    ReplaceFIFO,		// the page that was brought in first
+    ReplaceClock,		// second chance: sweep the frames, skipping
+				// (and clearing) those whose use bit is set
+    ReplaceEnhancedClock,	// clock on (use, dirty): prefer clean pages,
+				// to save writing them out
+    ReplaceAging		// LRU approximation: shift the use bits into
+				// a counter on every fault, take the lowest
+};
+
+// How the kernel picks the TLB entry to throw out on a TLB miss, among
+// the entries of the set the missing page goes in.
+
+enum TLBPolicy {
+    TLBRandom,			// any of them
+    TLBLeastRecent		// the one used least recently
+};
+
+// How the pages of an address space are mapped to frames (see
+// translate.h).  With a TLB, the kernel looks them up to refill it.
+
+enum PageTableKind {
+    LinearTable,		// an entry for every page of the space
+    TwoLevelTable,		// leaf tables only for the parts in use
+    InvertedTable		// an entry per frame, shared by all spaces
+};
+
+// The core map records which page of which address space is in each
+// physical frame.  Frames are shared by all address spaces: a page
+// fault takes a free frame if there is one, and otherwise the
+// replacement policy picks a victim among all the frames in use.  If
+// "quota" is not 0, an address space that already holds "quota" frames
+// has to give up one of its own instead (local replacement).
+
+class CoreMap {
+  public:
+    CoreMap(int frames, ReplacePolicy replacePolicy, int spaceQuota);
+    ~CoreMap();
+
+    int Allocate(AddrSpace *space, int vpn);
+				// Find a frame for page "vpn" of "space",
+				// evicting a page if there is none free
+    void Free(int frame);	// A frame is no longer in use
+
+  private:
+    int numFrames;
+    ReplacePolicy policy;
+    int quota;			// frames per address space, or 0
+    BitMap *freeFrames;		// which frames are in use
+    AddrSpace **owner;		// address space using each frame, if any
+    int *virtPage;		// and the page of it that is there
+    int *loadTime;		// when the page was brought in (for FIFO)
+    unsigned char *age;		// use bit history (for aging)
+    int *framesOf;		// # of frames held by each space id
+    int loads;			// # of pages brought in so far
+    int hand;			// where the clock sweep is
+
+    bool Candidate(int frame, AddrSpace *space);
+				// May "frame" be taken from "space"
+				// (NULL for any space)?
+    int Victim(AddrSpace *space);
+				// Pick a frame to empty
+    TranslationEntry *Entry(int frame);
+				// The page table entry mapped to "frame"
+};
+
 class AddrSpace {
   public:
     AddrSpace(OpenFile *executable);	// Create an address space,
@@ -36,18 +108,67 @@ class AddrSpace {
     void RestoreState();		// info on a context switch 
     void Print(); // print state of memory
     int GetSpaceId();
-    void FIFO(int newPage);//swap algorithm
+    void PageIn(int newPage);//page fault: bring a page into memory
+    void Evict(int oldPage);//give up the frame of a page
+    TranslationEntry *GetEntry(int vPage);//page table entry of a page,
+                                          //or NULL if it has none
     void readIn(int newPage);//read from disk to mem
     void writeOut(int newPage);//write from mem to disk
-  
+    bool SwapOutPending();//has the medium-term scheduler picked this space?
+    void SwapOut();//give up all frames and sleep until readmitted
+    bool TLBMiss(int vPage);//load the TLB from the page table, if the
+                            //page is in memory
+    static void TLBSync();//copy the TLB's use and dirty bits to the
+                          //page tables, before the kernel looks at them
+
+    static void SampleWorkingSets();//on a timer interrupt in user mode
+    static ReplacePolicy policy;	// set before the first space
+    static int frameQuota;		// is created (see main.cc)
+    static int swapCluster;		// most pages written out at once
+    static int workingSetWindow;	// samples a page stays in the
+					// working set, or 0 for no swapping
+    static TLBPolicy tlbPolicy;		// TLB replacement, with -tlb
+    static PageTableKind pageTableKind;	// set before the first space
+    static bool measurePageTables;	// keep the peak page table size
+    static int virtualPages;		// least # of pages of a space
 
   private:
-    TranslationEntry *pageTable;	//virtual page table
+    TranslationEntry *pageTable;	//virtual page table, if linear
+    TwoLevelPageTable *twoLevelTable;	//or two-level
+    static InvertedPageTable *invertedTable;  //or inverted, for all spaces
     unsigned int numPages;		// Number of pages in the virtual 
     int spaceId;  // address space
-    static BitMap *freeMap,*spaceIdMap; //tool map to allocate
+    static BitMap *spaceIdMap; //tool map to allocate
+    static CoreMap *coreMap;		// frames of physical memory
     char swapFileName[20];  //format:"SWAP{spaceId}", it won't be too large
-    List *pageQueue;  //queue for the FIFO algorithm
+    OpenFile *swapFile;  //kept open while the space exists; vPage i is
+                         //at i*PageSize, so neighbours are contiguous
+                         //(NULL until a page is first written out)
+    BitMap *onSwap;  //has each vPage been written to the swap file?
+    OpenFile *execFile;  //the executable, where code and data pages are
+                         //loaded from
+    NoffHeader noffH;  //where the segments are, in it and in memory
+    void LoadSegment(Segment *seg, int vPage, char *frame);
+                         //copy the part of seg in vPage from executable
+
+    int samples;  //timer samples taken while this space ran (its
+                  //virtual time, for the working set)
+    int *lastUsed;  //sample at which each vPage was last seen used, or -1
+                    //(NULL if working sets aren't sampled)
+    int workingSet;  //# of vPages used in the last workingSetWindow samples
+    bool swappedOut;  //suspended by the medium-term scheduler?
+    bool swapOutPending;  //to be suspended, next time it runs
+    Thread *thread;  //the thread to wake up, while swapped out
+    int runStart;  //stats->userTicks when it last got the CPU
+    static AddrSpace *spaces[NumProcess];  //every space, by spaceId
+    static List *swappedSpaces;  //suspended spaces, first out first in
+    static void Balance();  //suspend or readmit a space, if need be
+    TranslationEntry *TLBEntry(int vPage);  //vPage's TLB entry, or NULL
+    TranslationEntry *InMemory(int vPage);  //vPage's entry, if it is valid
+    TranslationEntry *RefillEntry(int vPage);  //InMemory, counted in stats
+    void Map(int vPage,int frame);  //make vPage valid, in frame
+    void Unmap(int vPage);  //make vPage invalid
+    static void MeasurePageTables();  //update stats->maxPageTableBytes
 };
 
 #endif // ADDRSPACE_H
@@ -84,8 +84,11 @@ ExceptionHandler(ExceptionType which)
             }
         }
     } else if(which==PageFaultException){
-        stats->numPageFaults++;
         int badVAddr=machine->ReadRegister(BadVAddrReg);
+        if(machine->tlb!=NULL&&currentThread->space->TLBMiss(badVAddr/PageSize))
+            return;//only a TLB miss: the page is in memory
+        stats->numPageFaults++;
+        stats->pageFaultsOf[currentThread->space->GetSpaceId()]++;
         printf("page fault exception badVAddr:%d\n",badVAddr);
         interrupt->PageFault(badVAddr);
     }else{
@@ -48,6 +48,131 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time,
     arg = param;
     when = time;
     type = kind;
+    order = 0;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::PendingQueue
+// 	Initialize an empty queue of pending interrupts.
+//----------------------------------------------------------------------
+
+PendingQueue::PendingQueue()
+{
+    maxItems = 8;
+    heap = new PendingInterrupt *[maxItems];
+    numItems = 0;
+    nextOrder = 0;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::~PendingQueue
+// 	De-allocate the queue, along with any interrupts still on it.
+//----------------------------------------------------------------------
+
+PendingQueue::~PendingQueue()
+{
+    for (int i = 0; i < numItems; i++)
+	delete heap[i];
+    delete [] heap;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Before
+// 	Return TRUE if interrupt "a" is to occur before "b": it is due
+//	earlier, or at the same time but was scheduled first.
+//----------------------------------------------------------------------
+
+bool
+PendingQueue::Before(PendingInterrupt *a, PendingInterrupt *b)
+{
+    if (a->when != b->when)
+	return (a->when < b->when);
+    return (a->order < b->order);
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Insert
+// 	Put an interrupt on the queue, growing the heap if it is full,
+//	and sift it up to its place.
+//----------------------------------------------------------------------
+
+void
+PendingQueue::Insert(PendingInterrupt *pend)
+{
+    int i, parent;
+
+    if (numItems == maxItems) {
+	PendingInterrupt **bigger = new PendingInterrupt *[maxItems * 2];
+
+	for (i = 0; i < numItems; i++)
+	    bigger[i] = heap[i];
+	delete [] heap;
+	heap = bigger;
+	maxItems *= 2;
+    }
+    pend->order = nextOrder++;
+    for (i = numItems++; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (!Before(pend, heap[parent]))
+	    break;
+	heap[i] = heap[parent];
+    }
+    heap[i] = pend;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::RemoveFirst
+// 	Take the next interrupt due off the queue, and sift the last
+//	element down to fill the hole.
+//
+// Returns:
+//	The interrupt, or NULL if the queue is empty.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+PendingQueue::RemoveFirst()
+{
+    PendingInterrupt *first, *last;
+    int i, child;
+
+    if (numItems == 0)
+	return NULL;
+    first = heap[0];
+    last = heap[--numItems];
+    for (i = 0; (child = 2 * i + 1) < numItems; i = child) {
+	if ((child + 1 < numItems) && Before(heap[child + 1], heap[child]))
+	    child++;
+	if (!Before(heap[child], last))
+	    break;
+	heap[i] = heap[child];
+    }
+    heap[i] = last;
+    return first;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Apply
+// 	Call "func" on each interrupt on the queue, in the order they are
+//	to occur.  Only used for debugging, so we don't mind sorting a
+//	copy of the heap to do it.
+//----------------------------------------------------------------------
+
+void
+PendingQueue::Apply(VoidFunctionPtr func)
+{
+    PendingInterrupt **sorted = new PendingInterrupt *[numItems + 1];
+    PendingInterrupt *pend;
+    int i, j;
+
+    for (i = 0; i < numItems; i++) {		// insertion sort
+	pend = heap[i];
+	for (j = i; (j > 0) && Before(pend, sorted[j - 1]); j--)
+	    sorted[j] = sorted[j - 1];
+	sorted[j] = pend;
+    }
+    for (i = 0; i < numItems; i++)
+	(*func)((_int) sorted[i]);
+    delete [] sorted;
 }
 
 //----------------------------------------------------------------------
@@ -60,7 +185,9 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pending = new PendingQueue();
+    nextDue = NeverDue;
+    tracing = DebugIsEnabled('i');
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -73,8 +200,6 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	    delete (ListElement *)(pending->Remove());
     delete pending;
 }
 
@@ -160,6 +285,8 @@ Interrupt::OneTick()
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
     }
+    if ((stats->totalTicks < nextDue) && !tracing)
+	return;				// nothing is due yet
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
 // check any pending interrupts are now ready to fire
@@ -169,6 +296,12 @@ Interrupt::OneTick()
     while (CheckIfDue(FALSE))		// check for pending interrupts
 	;
     ChangeLevel(IntOff, IntOn);		// re-enable interrupts
+    if (old == UserMode && currentThread->space->SwapOutPending()) {
+	yieldOnReturn = FALSE;		// the medium-term scheduler wants
+	status = SystemMode;		// the program out of memory
+	currentThread->space->SwapOut();
+	status = old;
+    }
     if (yieldOnReturn) {		// if the timer device handler asked 
 					// for a context switch, ok to do it now
 	yieldOnReturn = FALSE;
@@ -241,6 +374,8 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+    if (currentThread->space != NULL)
+	currentThread->space->SaveState();	// charge it its last ticks
     stats->Print();
     Cleanup();     // Never returns.
 }
@@ -271,7 +406,9 @@ Interrupt::Schedule(VoidFunctionPtr handler, _int arg, int fromNow, IntType type
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    pending->Insert(toOccur);
+    if (when < nextDue)
+	nextDue = when;
 }
 
 //----------------------------------------------------------------------
@@ -297,38 +434,42 @@ Interrupt::CheckIfDue(bool advanceClock)
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
+    PendingInterrupt *toOccur = pending->First();
 
     if (toOccur == NULL)		// no pending interrupts
 	return FALSE;			
 
+    when = toOccur->when;
     if (advanceClock && when > stats->totalTicks) {	// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
-	return FALSE;
+    } else if (when > stats->totalTicks) {	// not time yet; leave it
+	return FALSE;				// on the queue
     }
+    pending->RemoveFirst();
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
 				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
+	 pending->Insert(toOccur);
 	 return FALSE;
     }
+    nextDue = pending->IsEmpty() ? NeverDue : pending->First()->when;
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
-#ifdef USER_PROGRAM
-    if (machine != NULL)
-    	machine->DelayedLoad(0, 0);
-#endif
+    // A load the user program has in progress is left alone: it is
+    // part of the user registers (LoadReg, LoadValueReg) saved if we
+    // switch threads, and completes after the next user instruction,
+    // as it would have.  Completing it now would let the instruction
+    // in its delay slot see the loaded value rather than the old one.
     inHandler = TRUE;
     status = SystemMode;			// whatever we were doing,
 						// we are now going to be
 						// running in the kernel
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
+    if (toOccur->type == TimerInt && old == UserMode)
+	AddrSpace::SampleWorkingSets();		// and see what it is using
     status = old;				// restore the machine status
     inHandler = FALSE;
     delete toOccur;
@@ -363,7 +504,7 @@ Interrupt::DumpState()
 					intLevelNames[level]);
     printf("Pending interrupts:\n");
     fflush(stdout);
-    pending->Mapcar(PrintPending);
+    pending->Apply(PrintPending);
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
@@ -373,7 +514,7 @@ Interrupt::DumpState()
 // 	Run the process, with init of its addrSpace
 //----------------------------------------------------------------------
 void 
-InitProcess(int spaceId){
+InitProcess(_int spaceId){
     ASSERT(currentThread->space->GetSpaceId()==spaceId);    //ensure addrSpace is inited properly
     currentThread->space->InitRegisters();  
     currentThread->space->RestoreState();
@@ -402,7 +543,7 @@ Interrupt::Exec(){
 
     printf("Exec(%s):\n",filename);
     AddrSpace *space=new AddrSpace(executable);//allocate new addrspace
-    delete executable;//close file
+                                              //(it keeps the file open)
 
     Thread *thread=new Thread(filename);//new kernal thread
     thread->space=space;//user thread map to kernal thread
@@ -421,5 +562,5 @@ Interrupt::Exec(){
 void
 Interrupt::PageFault(int badVAddr){
     int newPage=badVAddr/PageSize;
-    currentThread->space->FIFO(newPage);
+    currentThread->space->PageIn(newPage);
 }
\ No newline at end of file
@@ -52,6 +52,9 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 				NetworkSendInt, NetworkRecvInt};
 
+// NextDueTime() when there are no pending interrupts
+#define NeverDue	0x7fffffff
+
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
@@ -67,6 +70,44 @@ class PendingInterrupt {
     _int arg;           // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    int order;			// set by PendingQueue: interrupts due at
+				// the same time fire in the order
+				// they were scheduled
+};
+
+// The following class defines the queue of interrupts scheduled to occur
+// in the future.  It is a binary min-heap, ordered by "when" (and then
+// by "order"), so the next interrupt due can be looked at in constant
+// time, and interrupts can be added or taken off in O(log n) time,
+// however many devices have something pending.
+
+class PendingQueue {
+  public:
+    PendingQueue();			// initialize an empty queue
+    ~PendingQueue();			// de-allocate the queue, and
+					// anything still on it
+
+    void Insert(PendingInterrupt *pend);// Put an interrupt on the queue
+    PendingInterrupt *RemoveFirst();	// Take the next interrupt due off
+					// the queue; NULL if it's empty
+    PendingInterrupt *First() { return (numItems > 0) ? heap[0] : NULL; }
+					// The next interrupt due, if any
+    bool IsEmpty() { return (numItems == 0); }
+
+    void Apply(VoidFunctionPtr func);	// Apply "func" to every interrupt
+					// on the queue, in the order they
+					// will occur
+
+  private:
+    PendingInterrupt **heap;		// heap[0] is the next due; the
+					// children of heap[i] are at
+					// heap[2i+1] and heap[2i+2]
+    int numItems;			// # of interrupts on the queue
+    int maxItems;			// size of the "heap" array
+    int nextOrder;			// "order" for the next Insert
+
+    bool Before(PendingInterrupt *a, PendingInterrupt *b);
+					// Does "a" occur before "b"?
 };
 
 // The following class defines the data structures for the simulation
@@ -97,6 +138,7 @@ class Interrupt {
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
     void setStatus(MachineStatus st) { status = st; }
+    bool isInHandler() { return inHandler; } // in an interrupt handler?
 
     void DumpState();			// Print interrupt state
     
@@ -111,13 +153,23 @@ class Interrupt {
 	                    // This is called by the hardware device simulators.
     
     void OneTick();       		// Advance simulated time
+
+    int NextDueTime() { return nextDue; }
+					// When is the next interrupt
+					// scheduled to occur?
     void Exec();
     void PageFault(int badVAddr);
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
-				// to occur in the future
+    PendingQueue *pending;	// the interrupts scheduled to occur in
+				// the future
+    int nextDue;		// when the first of them is due, or
+				// NeverDue; lets OneTick skip the
+				// checks when nothing is due
+    bool tracing;		// are we printing interrupt debug
+				// messages (-d i)?  If so, OneTick
+				// can't skip anything
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
@@ -9,7 +9,12 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-sp <fifo|priority|heap|mlfq> -sq <quantum,...> -sb <period>
+//		-s -bb -ff -np <# pages> -ps <page size> -tlb <# TLB entries>
+//		-tlbw <# ways>
+//		-pr <policy> -fq <# frames> -sc <# pages> -ws <# samples>
+//		-tlbr <random|lru> -pt <linear|twolevel|inverted> -va <# pages>
+//		-x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -e <network orderability>
@@ -19,13 +24,52 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sp sets the order ready threads run in: fifo (the default), or
+//	lowest priority # first, from a bitmap of per-priority queues
+//	(priority) or from a heap (heap), or from a multi-level feedback
+//	queue (mlfq), in which a thread moves down a level each time it
+//	uses up its quantum, and back to the top when woken up by a device
+//    -sq sets the quantum of each level of the feedback queue, in timer
+//	interrupts, from the top (default 1,2,4,8)
+//    -sb sets the # of timer interrupts between moving every thread back
+//	up to the top level (default 50)
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs a basic block at a time, as threaded code
+//    -ff only checks for interrupts when one is due (same simulated time)
+//    -np, -ps set the number of physical pages and the page size of the
+//	simulated machine
+//    -pr sets the page replacement policy: fifo (the default), clock,
+//	eclock (enhanced clock) or aging
+//    -fq sets the # of frames each process may hold (default 5); 0
+//	lets processes take frames from each other
+//    -sc writes up to this many adjacent dirty pages out together
+//	when one of them is evicted (default 1).  -pr, -fq and -sc
+//	must come before -x
+//    -ws suspends and swaps out programs when their working sets (the
+//	pages each used in its last <# samples> timer interrupts) do
+//	not all fit in memory, and brings them back when they do
+//    -pt sets the kind of page table: linear (the default), twolevel or
+//	inverted (hashed, one for all programs), and prints how much
+//	memory the page tables took and how many entries were probed
+//    -va makes each address space at least this many pages, with the
+//	stack at the top and the gap above the program zero-filled on
+//	demand.  -pt and -va must come before -x
 //    -x runs a user program
 //    -c tests the console
 //
+//  VM
+//    -tlb sets the number of TLB entries of the simulated machine (0,
+//	the default unless built with USE_TLB, means none); the kernel
+//	refills the TLB from the page table on a miss.  With a TLB, -bb
+//	has no effect, as every instruction fetch must look it up
+//    -tlbw sets the associativity of the TLB (at least 2; default: fully
+//	associative)
+//    -tlbr sets how the kernel picks a TLB entry to replace on a TLB
+//	miss (with -tlb): random (the default) or lru
+//
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
@@ -63,6 +107,22 @@ extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// TimeSlice
+// 	Timer interrupt handler for -ws, when -rs has not already
+//	started the timer: switch to another thread every TimerTicks, so
+//	that every program runs (and its working set gets sampled).
+//----------------------------------------------------------------------
+
+static void
+TimeSlice(_int dummy)
+{
+    if (interrupt->getStatus() != IdleMode)
+	interrupt->YieldOnReturn();
+}
+#endif // USER_PROGRAM
+
 //----------------------------------------------------------------------
 // main
 // 	Bootstrap the operating system kernel.  
@@ -99,6 +159,58 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-pr")) {	// page replacement policy
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		AddrSpace::policy = ReplaceFIFO;
+	    else if (!strcmp(*(argv + 1), "clock"))
+		AddrSpace::policy = ReplaceClock;
+	    else if (!strcmp(*(argv + 1), "eclock"))
+		AddrSpace::policy = ReplaceEnhancedClock;
+	    else if (!strcmp(*(argv + 1), "aging"))
+		AddrSpace::policy = ReplaceAging;
+	    else
+		ASSERT(FALSE);
+	    argCount = 2;
+        } else if (!strcmp(*argv, "-fq")) {	// frames per process
+	    ASSERT(argc > 1);
+	    AddrSpace::frameQuota = atoi(*(argv + 1));
+	    argCount = 2;
+        } else if (!strcmp(*argv, "-sc")) {	// swap-out cluster size
+	    ASSERT(argc > 1);
+	    AddrSpace::swapCluster = atoi(*(argv + 1));
+	    argCount = 2;
+        } else if (!strcmp(*argv, "-tlbr")) {	// TLB replacement policy
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "random"))
+		AddrSpace::tlbPolicy = TLBRandom;
+	    else if (!strcmp(*(argv + 1), "lru"))
+		AddrSpace::tlbPolicy = TLBLeastRecent;
+	    else
+		ASSERT(FALSE);
+	    argCount = 2;
+        } else if (!strcmp(*argv, "-pt")) {	// kind of page table
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "linear"))
+		AddrSpace::pageTableKind = LinearTable;
+	    else if (!strcmp(*(argv + 1), "twolevel"))
+		AddrSpace::pageTableKind = TwoLevelTable;
+	    else if (!strcmp(*(argv + 1), "inverted"))
+		AddrSpace::pageTableKind = InvertedTable;
+	    else
+		ASSERT(FALSE);
+	    AddrSpace::measurePageTables = TRUE;
+	    argCount = 2;
+        } else if (!strcmp(*argv, "-va")) {	// virtual address space size
+	    ASSERT(argc > 1);
+	    AddrSpace::virtualPages = atoi(*(argv + 1));
+	    argCount = 2;
+        } else if (!strcmp(*argv, "-ws")) {	// working set window
+	    ASSERT(argc > 1);
+	    AddrSpace::workingSetWindow = atoi(*(argv + 1));
+	    if (timer == NULL)		// sampled on timer interrupts
+		timer = new Timer(TimeSlice, 0, FALSE);
+	    argCount = 2;
         } else if (!strcmp(*argv, "-c")) {      // test the console
 	    if (argc == 1)
 	        ConsoleTest(NULL, NULL);
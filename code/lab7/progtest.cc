@@ -31,9 +31,7 @@ StartProcess(char *filename)
 	return;
     }
     space = new AddrSpace(executable);    
-    currentThread->space = space;
-
-    delete executable;			// close file
+    currentThread->space = space;	// the space closes the file
 
     space->InitRegisters();		// set the initial register values
     space->RestoreState();		// load page table register
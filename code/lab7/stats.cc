@@ -20,8 +20,13 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = numCacheEvictions = 0;
+    numTLBHits = numTLBMisses = 0;
+    numPageTableLookups = numPageTableProbes = maxPageTableBytes = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = numPageWriteOuts = 0;
+    for (int i = 0; i < NumProcess; i++)
+	pageFaultsOf[i] = userTicksOf[i] = swapOutsOf[i] = 0;
 }
 
 //----------------------------------------------------------------------
@@ -36,9 +41,21 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    printf("Disk cache: hits %d, misses %d, evictions %d\n", numCacheHits,
+	numCacheMisses, numCacheEvictions);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d, write out %d\n", numPageFaults,numPageWriteOuts);
+    if (numTLBHits + numTLBMisses > 0)		// if there is a TLB
+	printf("TLB: hits %d, misses %d\n", numTLBHits, numTLBMisses);
+    if (maxPageTableBytes > 0)
+	printf("Page tables: lookups %d, probes %d, peak size %d bytes\n",
+	       numPageTableLookups, numPageTableProbes, maxPageTableBytes);
+    for (int i = 0; i < NumProcess; i++)
+	if (userTicksOf[i] > 0)
+	    printf("Paging of space %d: faults %d in %d ticks (%d per 1000), "
+		"swapped out %d\n", i, pageFaultsOf[i], userTicksOf[i],
+		pageFaultsOf[i] * 1000 / userTicksOf[i], swapOutsOf[i]);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
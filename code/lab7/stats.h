@@ -13,6 +13,8 @@
 
 #include "copyright.h"
 
+#define NumProcess 256		// most address spaces at once
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
@@ -35,7 +37,20 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numCacheHits;		// disk requests found in the buffer cache
+    int numCacheMisses;		// disk requests not found in the cache
+    int numCacheEvictions;	// sectors evicted from the cache
+    int numTLBHits;		// TLB lookups that found the page
+    int numTLBMisses;		// TLB lookups that did not
+    int numPageTableLookups;	// translations done with the page table
+    int numPageTableProbes;	// page table entries read doing them
+    int maxPageTableBytes;	// most memory taken by the page tables
+				// at once, if the kernel measures it
     int numPageWriteOuts; // number of virtual memory page write into disk when dirty
+    int pageFaultsOf[NumProcess];	// page faults of each space id
+    int userTicksOf[NumProcess];	// user instructions run by each
+    int swapOutsOf[NumProcess];		// times each was suspended and
+					// swapped out
 
     Statistics(); 		// initialize everything to zero
 
@@ -50,28 +50,76 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"blocks" -- if TRUE, execute user code a basic block at a time
+//		(see RunBlock).  Not used while single-stepping or tracing,
+//		which need to see every instruction.
+//	"skipTicks" -- if TRUE, only call OneTick when an interrupt may
+//		be due (see RunAhead).  Not used while single-stepping or
+//		tracing interrupts, which need to see every tick.
+//	"numPages" -- the number of page frames of physical memory
+//	"pageBytes" -- the size of a page; must be a power of 2
+//	"tlbEntries" -- the number of TLB entries, or 0 for no TLB
+//	"tlbAssoc" -- the number of ways of the TLB (at least 2), or 0
+//		for fully associative
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, bool blocks, bool skipTicks, int numPages,
+		 int pageBytes, int tlbEntries, int tlbAssoc)
 {
     int i;
 
+    ASSERT((numPages > 0) && (tlbEntries >= 0));
+    ASSERT((pageBytes >= 4) && ((pageBytes & (pageBytes - 1)) == 0));
+    pageSize = pageBytes;
+    for (pageShift = 0; (1 << pageShift) < pageSize; pageShift++)
+	;
+    numPhysPages = numPages;
+    memorySize = numPhysPages * pageSize;
+    tlbSize = tlbEntries;
+    tlbWays = (tlbAssoc > 0) ? tlbAssoc : tlbEntries;
+    ASSERT(tlbSize == 0 || (tlbWays <= tlbSize && tlbSize % tlbWays == 0));
+    ASSERT(tlbSize == 0 || tlbWays >= 2);	// an instruction may need its
+					// own page and a data page in the
+					// same set at once
+
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
-    mainMemory = new char[MemorySize];
-    for (i = 0; i < MemorySize; i++)
+    mainMemory = new char[memorySize];
+    for (i = 0; i < memorySize; i++)
       	mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else	// use linear page table
-    tlb = NULL;
+    decodeCache = new Instruction[memorySize / 4];
+    decodeValid = new bool[numPhysPages];
+    threadedCode = new OpHandler[memorySize / 4];
+    blockLength = new unsigned char[memorySize / 4];
+    for (i = 0; i < numPhysPages; i++)
+	decodeValid[i] = FALSE;
+    if (tlbSize > 0) {
+	tlb = new TranslationEntry[tlbSize];
+	tlbLastUse = new int[tlbSize];
+	for (i = 0; i < tlbSize; i++) {
+	    tlb[i].valid = FALSE;
+	    tlbLastUse[i] = 0;
+	}
+    } else {		// use linear page table
+	tlb = NULL;
+	tlbLastUse = NULL;
+    }
     pageTable = NULL;
-#endif
+    twoLevelTable = NULL;
+    invertedTable = NULL;
+    asid = 0;
+    tlbLookups = 0;
 
     singleStep = debug;
+    useBlocks = blocks && !debug && !DebugIsEnabled('m')
+		&& !DebugIsEnabled('i') && !DebugIsEnabled('a');
+    fastForward = skipTicks && !debug && !DebugIsEnabled('i');
+    uncharged = 0;
+    cacheTranslations = !DebugIsEnabled('a') && (tlb == NULL);
+				// with a TLB, every reference must look
+				// it up, to be counted and to keep
+				// tlbLastUse up to date
+    FlushTranslationCache();
     CheckEndian();
 }
 
@@ -83,8 +131,14 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
+    delete [] decodeCache;
+    delete [] decodeValid;
+    delete [] threadedCode;
+    delete [] blockLength;
+    if (tlb != NULL) {
         delete [] tlb;
+	delete [] tlbLastUse;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -103,13 +157,36 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     DEBUG('m', "Exception: %s\n", exceptionNames[which]);
     
 //  ASSERT(interrupt->getStatus() == UserMode);
+    CatchUpTime();			// charge for any instructions that
+					// ran before this one
     registers[BadVAddrReg] = badVAddr;
-    DelayedLoad(0, 0);			// finish anything in progress
+    if (which == SyscallException)	// the syscall is done: finish any
+	DelayedLoad(0, 0);		// load in progress.  Otherwise the
+					// instruction is restarted, still in
+					// the delay slot, so the load stays
+					// pending (with the user registers)
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
+    FlushTranslationCache();		// the kernel may have changed the
+					// page table or TLB
     interrupt->setStatus(UserMode);
 }
 
+//----------------------------------------------------------------------
+// Machine::CatchUpTime
+// 	Charge simulated time for the user instructions that have run
+//	without a OneTick (by RunBlock or RunAhead).  None of them can
+//	have had an interrupt fall due, so there is nothing else to do.
+//----------------------------------------------------------------------
+
+void
+Machine::CatchUpTime()
+{
+    stats->totalTicks += uncharged * UserTick;
+    stats->userTicks += uncharged * UserTick;
+    uncharged = 0;
+}
+
 //----------------------------------------------------------------------
 // Machine::Debugger
 // 	Primitive debugger for user programs.  Note that we can't use
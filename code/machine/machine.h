@@ -27,14 +27,30 @@
 #include "disk.h"
 
 // Definitions related to the size, and format of user memory
-
-#define PageSize 	SectorSize 	// set the page size equal to
-					// the disk sector size, for
-					// simplicity
-
-#define NumPhysPages    32
+//
+// The sizes of pages, physical memory and the TLB are fixed when the
+// machine is created (see the -ps, -np, -tlb and -tlbw flags in
+// system.cc); these are the defaults.  A TLB size of 0 means no TLB:
+// the kernel gives the machine a linear page table instead.
+
+#define DefaultPageSize 	SectorSize 	// set the page size equal to
+						// the disk sector size, for
+						// simplicity
+
+#define DefaultNumPhysPages	32
+#ifdef USE_TLB
+#define DefaultTLBSize		4	// if there is a TLB, make it small
+#else
+#define DefaultTLBSize		0
+#endif
+
+// The sizes of the machine we are running on.  For kernel code only --
+// the machine emulation itself uses its own copies.
+
+#define PageSize 	(machine->pageSize)
+#define NumPhysPages    (machine->numPhysPages)
 #define MemorySize 	(NumPhysPages * PageSize)
-#define TLBSize		4		// if there is a TLB, make it small
+#define TLBSize		(machine->tlbSize)
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -104,10 +120,44 @@ class Instruction {
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
+// The following class defines an entry in the translation cache: a
+// host-side, direct-mapped cache of recent successful translations,
+// indexed by virtual page number.  It lets ReadMem, WriteMem and
+// Translate skip the page table or TLB lookup, and the checks that go
+// with it, for pages that are known to be mapped.
+//
+// An entry is only made once the use bit (and, if "writable", the dirty
+// bit) of the page is already set, so a hit never has to touch the page
+// table or TLB.  The cache must be flushed whenever the kernel may have
+// changed the page table or TLB: on RestoreState, and when returning
+// from an exception (see Machine::FlushTranslationCache).
+
+#define TransCacheSize	64	// # of entries; must be a power of 2
+
+class CachedTranslation {
+  public:
+    int virtualPage;		// the page, or -1 if the entry is empty
+    int physicalPage;		// the frame it is mapped to
+    char *hostAddr;		// &mainMemory[physicalPage * pageSize]
+    bool writable;		// TRUE if writes can take the fast path
+				// too (page is not read-only, and is
+				// already dirty)
+};
+
+class Machine;
+
+// Threaded code: a routine that executes one (decoded) instruction;
+// returns FALSE if the instruction raised an exception.
+typedef bool (*OpHandler)(Machine *m, Instruction *instr);
+
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
-				// for running user programs
+    Machine(bool debug, bool blocks, bool skipTicks, int numPages,
+	    int pageBytes, int tlbEntries, int tlbAssoc);
+				// Initialize the simulation of the hardware
+				// for running user programs; "blocks"
+				// selects the basic block engine,
+				// "skipTicks" fast-forwarding
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
@@ -118,11 +168,42 @@ class Machine {
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    void FlushTranslationCache();
+				// forget all cached translations; must be
+				// called whenever the kernel changes the
+				// page table or TLB outside of an exception
+				// handler
+
+    void InvalidateDecodeCache(int pageFrame);
+				// forget the pre-decoded instructions of a
+				// physical page; must be called whenever the
+				// kernel changes mainMemory behind our back
+				// (eg, loading or paging in a frame)
+
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
-    void OneInstruction(Instruction *instr); 	
+    bool OneInstruction(Instruction *instr); 	
     				// Run one instruction of a user program.
+				// Return FALSE if it raised an exception.
+    bool FetchInstruction(int addr, Instruction *instr);
+				// Fetch and decode the instruction at "addr",
+				// using the pre-decoded copy of its frame
+				// if there is one.
+    bool ExecuteInstruction(Instruction *instr);
+				// Execute a decoded instruction.  Return
+				// FALSE if it raised an exception.
+    bool RunBlock();		// Run one basic block as threaded code.
+				// Return FALSE if the next instruction
+				// must go through OneInstruction instead.
+    bool RunAhead(Instruction *instr);
+				// Run one instruction without a OneTick.
+				// Return FALSE if it needs the OneTick.
+    void CatchUpTime();		// Charge for the instructions run by
+				// RunBlock or RunAhead
+    void DecodePage(int pageFrame);
+				// (Re-)build the decoded instructions and
+				// threaded code of a physical page
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
@@ -132,6 +213,11 @@ class Machine {
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
     
+    char *CachedAddress(int virtAddr, int size, bool writing);
+				// Look up "virtAddr" in the translation
+				// cache; return its host address, or NULL
+				// if it needs a full translation.
+
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
 				// alignment.  Set the use and dirty bits in 
@@ -155,6 +241,16 @@ class Machine {
 
     char *mainMemory;		// physical memory to store user program,
 				// code and data, while executing
+    int pageSize;		// bytes per page (a power of 2)
+    int numPhysPages;		// # of page frames in mainMemory
+    int memorySize;		// numPhysPages * pageSize
+    int tlbSize;		// # of TLB entries, if there is a TLB
+    int tlbWays;		// # of entries a page can be in: the
+				// TLB is split into tlbSize / tlbWays
+				// sets, and page "vpn" can only be in
+				// set vpn % (tlbSize / tlbWays)
+				// (these five should be considered
+				// "read-only" to Nachos kernel code)
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
 
@@ -162,10 +258,11 @@ class Machine {
 // to physical addresses (relative to the beginning of "mainMemory")
 // can be controlled by one of:
 //	a traditional linear page table
+//	a two-level page table, or a hashed inverted page table
 //  	a software-loaded translation lookaside buffer (tlb) -- a cache of 
 //	  mappings of virtual page #'s to physical page #'s
 //
-// If "tlb" is NULL, the linear page table is used
+// If "tlb" is NULL, whichever page table the kernel set is used
 // If "tlb" is non-NULL, the Nachos kernel is responsible for managing
 //	the contents of the TLB.  But the kernel can use any data structure
 //	it wants (eg, segmented paging) for handling TLB cache misses.
@@ -178,15 +275,46 @@ class Machine {
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int *tlbLastUse;			// when each TLB entry was last used,
+					// counting TLB lookups, for the
+					// kernel's replacement policy
+    int asid;				// TLB entries only match if their
+					// "asid" is this (set by the kernel)
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
+    TwoLevelPageTable *twoLevelTable;	// used instead of "pageTable",
+    InvertedPageTable *invertedTable;	// if the kernel sets one of these
+					// (the inverted table is looked up
+					// with "asid")
+
   private:
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+
+    Instruction *decodeCache;	// decoded copy of every word of mainMemory,
+				// indexed by physical address / 4
+    bool *decodeValid;		// per physical page: is its part of
+				// decodeCache up to date?
+    OpHandler *threadedCode;	// handler for each entry of decodeCache
+    unsigned char *blockLength;	// # of instructions in the basic block
+				// starting at each entry of decodeCache
+    int pageShift;		// log2(pageSize)
+    CachedTranslation transCache[TransCacheSize];
+				// recent translations, indexed by
+				// virtual page # % TransCacheSize
+    bool cacheTranslations;	// FALSE when tracing address translation
+				// (-d a), which must see every access
+    bool useBlocks;		// run user code a basic block at a time
+    bool fastForward;		// only call OneTick when something
+				// may be due
+    int uncharged;		// user instructions completed, but not
+				// yet charged for in simulated time
+    int tlbLookups;		// # of TLB lookups so far (the clock
+				// for tlbLastUse)
 };
 
 extern void ExceptionHandler(ExceptionType which);
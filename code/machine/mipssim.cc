@@ -37,8 +37,10 @@ Machine::Run()
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
     for (;;) {
-        OneInstruction(instr);
-	interrupt->OneTick();
+	if (!(useBlocks && RunBlock()) && !(fastForward && RunAhead(instr))) {
+            OneInstruction(instr);
+	    interrupt->OneTick();
+	}
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
@@ -87,22 +89,17 @@ TypeToReg(RegType reg, Instruction *instr)
 //	store all data back to the machine registers and memory before
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
-//	and the register set.
+//	and the register set.  (The only exception is the decoded
+//	instruction cache, which is keyed by physical page and is dropped
+//	whenever the page changes -- see FetchInstruction.)
 //----------------------------------------------------------------------
 
-void
+bool
 Machine::OneInstruction(Instruction *instr)
 {
-    int raw;
-    int nextLoadReg = 0; 	
-    int nextLoadValue = 0; 	// record delayed load operation, to apply
-				// in the future
-
     // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
+    if (!FetchInstruction(registers[PCReg], instr))
+	return FALSE;		// exception occurred
 
     if (DebugIsEnabled('m')) {
        struct OpString *str = &opStrings[instr->opCode];
@@ -114,6 +111,26 @@ Machine::OneInstruction(Instruction *instr)
        printf("\n");
        }
     
+    return ExecuteInstruction(instr);
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute an instruction that has already been fetched and decoded,
+//	and advance the program counters past it.
+//
+//	Returns FALSE if the instruction raised an exception; in that case
+//	the exception has been handled, and the PC has not been advanced
+//	(the kernel may have done so itself, eg, for a syscall).
+//----------------------------------------------------------------------
+
+bool
+Machine::ExecuteInstruction(Instruction *instr)
+{
+    int nextLoadReg = 0; 	
+    int nextLoadValue = 0; 	// record delayed load operation, to apply
+				// in the future
+
     // Compute next pc, but don't install in case there's an error or branch.
     int pcAfter = registers[NextPCReg] + 4;
     int sum, diff, tmp, value;
@@ -127,7 +144,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -137,7 +154,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -232,7 +249,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
 	if (!machine->ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -247,10 +264,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -269,10 +286,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -286,7 +303,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -317,7 +334,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -383,13 +400,13 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SB:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -459,7 +476,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -471,7 +488,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SW:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -482,7 +499,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = registers[instr->rt];
@@ -501,7 +518,7 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SWR:	  
@@ -512,7 +529,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = (value & 0xffffff) | (registers[instr->rt] << 24);
@@ -528,12 +545,12 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE; 
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -546,7 +563,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -562,14 +579,18 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // Machine::DelayedLoad
 // 	Simulate effects of a delayed load.
 //
-// 	NOTE -- RaiseException/CheckInterrupts must also call DelayedLoad,
-//	since any delayed load must get applied before we trap to the kernel.
+// 	NOTE -- RaiseException calls DelayedLoad for a system call, since
+//	the syscall instruction is then complete.  A load still pending
+//	when an instruction faults, or when an interrupt comes in, is left
+//	for the next instruction to finish; it is saved with the rest of
+//	the user registers across a context switch.
 //----------------------------------------------------------------------
 
 void
@@ -581,6 +602,461 @@ Machine::DelayedLoad(int nextReg, int nextValue)
     registers[0] = 0; 	// and always make sure R0 stays zero.
 }
 
+//----------------------------------------------------------------------
+// Threaded code
+//
+//	With the "-bb" flag, Run executes user code a basic block at a
+//	time instead of one instruction at a time.  Each word of a decoded
+//	page (see DecodePage) is paired with a handler routine for its
+//	opcode, so a block is simply a run of consecutive (handler,
+//	instruction) pairs, called one after another without going
+//	through the big switch in ExecuteInstruction.
+//
+//	A block starts at any PC and ends with the delay slot of the first
+//	branch or jump, or at the end of the page, whichever comes first.
+//	Keeping blocks inside one page means a single translation of the
+//	PC covers the whole block.
+//
+//	The common instructions have their own handlers; everything else
+//	(and anything with unusual side effects) goes through DoGeneric,
+//	which just uses the reference interpreter.  Each handler returns
+//	FALSE if the instruction raised an exception.
+//----------------------------------------------------------------------
+
+// Advance the program counters, after doing any delayed load, exactly
+// as at the end of ExecuteInstruction.
+static inline void
+Retire(Machine *m, int pcAfter, int nextLoadReg, int nextLoadValue)
+{
+    int *r = m->registers;
+
+    m->DelayedLoad(nextLoadReg, nextLoadValue);
+    r[PrevPCReg] = r[PCReg];
+    r[PCReg] = r[NextPCReg];
+    r[NextPCReg] = pcAfter;
+}
+
+static bool
+DoGeneric(Machine *m, Instruction *instr)
+{
+    return m->ExecuteInstruction(instr);
+}
+
+static bool
+DoADD(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+    int sum = r[instr->rs] + r[instr->rt];
+
+    if (!((r[instr->rs] ^ r[instr->rt]) & SIGN_BIT) &&
+	((r[instr->rs] ^ sum) & SIGN_BIT)) {
+	m->RaiseException(OverflowException, 0);
+	return FALSE;
+    }
+    r[instr->rd] = sum;
+    Retire(m, r[NextPCReg] + 4, 0, 0);
+    return TRUE;
+}
+
+static bool
+DoADDI(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+    int sum = r[instr->rs] + instr->extra;
+
+    if (!((r[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+	((instr->extra ^ sum) & SIGN_BIT)) {
+	m->RaiseException(OverflowException, 0);
+	return FALSE;
+    }
+    r[instr->rt] = sum;
+    Retire(m, r[NextPCReg] + 4, 0, 0);
+    return TRUE;
+}
+
+static bool
+DoSUB(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+    int diff = r[instr->rs] - r[instr->rt];
+
+    if (((r[instr->rs] ^ r[instr->rt]) & SIGN_BIT) &&
+	((r[instr->rs] ^ diff) & SIGN_BIT)) {
+	m->RaiseException(OverflowException, 0);
+	return FALSE;
+    }
+    r[instr->rd] = diff;
+    Retire(m, r[NextPCReg] + 4, 0, 0);
+    return TRUE;
+}
+
+// Register-to-register and immediate ALU operations, none of which can
+// trap.
+#define ALU_HANDLER(name, expr)					\
+static bool							\
+name(Machine *m, Instruction *instr)				\
+{								\
+    int *r = m->registers;					\
+								\
+    expr;							\
+    Retire(m, r[NextPCReg] + 4, 0, 0);				\
+    return TRUE;						\
+}
+
+ALU_HANDLER(DoADDIU, r[instr->rt] = r[instr->rs] + instr->extra)
+ALU_HANDLER(DoADDU, r[instr->rd] = r[instr->rs] + r[instr->rt])
+ALU_HANDLER(DoSUBU, r[instr->rd] = r[instr->rs] - r[instr->rt])
+ALU_HANDLER(DoAND, r[instr->rd] = r[instr->rs] & r[instr->rt])
+ALU_HANDLER(DoANDI, r[instr->rt] = r[instr->rs] & (instr->extra & 0xffff))
+ALU_HANDLER(DoORI, r[instr->rt] = r[instr->rs] | (instr->extra & 0xffff))
+ALU_HANDLER(DoXOR, r[instr->rd] = r[instr->rs] ^ r[instr->rt])
+ALU_HANDLER(DoXORI, r[instr->rt] = r[instr->rs] ^ (instr->extra & 0xffff))
+ALU_HANDLER(DoNOR, r[instr->rd] = ~(r[instr->rs] | r[instr->rt]))
+ALU_HANDLER(DoLUI, r[instr->rt] = instr->extra << 16)
+ALU_HANDLER(DoSLL, r[instr->rd] = r[instr->rt] << instr->extra)
+ALU_HANDLER(DoSLLV, r[instr->rd] = r[instr->rt] << (r[instr->rs] & 0x1f))
+ALU_HANDLER(DoSRA, r[instr->rd] = r[instr->rt] >> instr->extra)
+ALU_HANDLER(DoSRAV, r[instr->rd] = r[instr->rt] >> (r[instr->rs] & 0x1f))
+ALU_HANDLER(DoSRL, r[instr->rd] = r[instr->rt] >> instr->extra)
+ALU_HANDLER(DoSRLV, r[instr->rd] = r[instr->rt] >> (r[instr->rs] & 0x1f))
+ALU_HANDLER(DoSLT, r[instr->rd] = (r[instr->rs] < r[instr->rt]))
+ALU_HANDLER(DoSLTI, r[instr->rt] = (r[instr->rs] < instr->extra))
+ALU_HANDLER(DoSLTIU, r[instr->rt] = ((unsigned int) r[instr->rs] <
+				(unsigned int) instr->extra))
+ALU_HANDLER(DoSLTU, r[instr->rd] = ((unsigned int) r[instr->rs] <
+				(unsigned int) r[instr->rt]))
+ALU_HANDLER(DoMFHI, r[instr->rd] = r[HiReg])
+ALU_HANDLER(DoMFLO, r[instr->rd] = r[LoReg])
+ALU_HANDLER(DoMTHI, r[HiReg] = r[instr->rs])
+ALU_HANDLER(DoMTLO, r[LoReg] = r[instr->rs])
+ALU_HANDLER(DoMULT, Mult(r[instr->rs], r[instr->rt], TRUE, &r[HiReg], &r[LoReg]))
+ALU_HANDLER(DoMULTU, Mult(r[instr->rs], r[instr->rt], FALSE, &r[HiReg], &r[LoReg]))
+
+// Conditional branches: "cond" decides whether the branch is taken.
+#define BRANCH_HANDLER(name, cond)				\
+static bool							\
+name(Machine *m, Instruction *instr)				\
+{								\
+    int *r = m->registers;					\
+    int pcAfter = r[NextPCReg] + 4;				\
+								\
+    if (cond)							\
+	pcAfter = r[NextPCReg] + IndexToAddr(instr->extra);	\
+    Retire(m, pcAfter, 0, 0);					\
+    return TRUE;						\
+}
+
+BRANCH_HANDLER(DoBEQ, r[instr->rs] == r[instr->rt])
+BRANCH_HANDLER(DoBNE, r[instr->rs] != r[instr->rt])
+BRANCH_HANDLER(DoBGEZ, !(r[instr->rs] & SIGN_BIT))
+BRANCH_HANDLER(DoBGTZ, r[instr->rs] > 0)
+BRANCH_HANDLER(DoBLEZ, r[instr->rs] <= 0)
+BRANCH_HANDLER(DoBLTZ, r[instr->rs] & SIGN_BIT)
+
+static bool
+DoJ(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+
+    Retire(m, ((r[NextPCReg] + 4) & 0xf0000000) | IndexToAddr(instr->extra),
+	   0, 0);
+    return TRUE;
+}
+
+static bool
+DoJAL(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+
+    r[R31] = r[NextPCReg] + 4;
+    return DoJ(m, instr);
+}
+
+static bool
+DoJR(Machine *m, Instruction *instr)
+{
+    Retire(m, m->registers[instr->rs], 0, 0);
+    return TRUE;
+}
+
+static bool
+DoJALR(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+    int pcAfter = r[instr->rs];
+
+    r[instr->rd] = r[NextPCReg] + 4;
+    Retire(m, pcAfter, 0, 0);
+    return TRUE;
+}
+
+static bool
+DoLW(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+    int addr = r[instr->rs] + instr->extra;
+    int value;
+
+    if (addr & 0x3) {
+	m->RaiseException(AddressErrorException, addr);
+	return FALSE;
+    }
+    if (!m->ReadMem(addr, 4, &value))
+	return FALSE;
+    Retire(m, r[NextPCReg] + 4, instr->rt, value);
+    return TRUE;
+}
+
+static bool
+DoLB(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+    int value;
+
+    if (!m->ReadMem(r[instr->rs] + instr->extra, 1, &value))
+	return FALSE;
+    if ((value & 0x80) && (instr->opCode == OP_LB))
+	value |= 0xffffff00;
+    else
+	value &= 0xff;
+    Retire(m, r[NextPCReg] + 4, instr->rt, value);
+    return TRUE;
+}
+
+static bool
+DoSW(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+
+    if (!m->WriteMem((unsigned) (r[instr->rs] + instr->extra), 4, r[instr->rt]))
+	return FALSE;
+    Retire(m, r[NextPCReg] + 4, 0, 0);
+    return TRUE;
+}
+
+static bool
+DoSB(Machine *m, Instruction *instr)
+{
+    int *r = m->registers;
+
+    if (!m->WriteMem((unsigned) (r[instr->rs] + instr->extra), 1, r[instr->rt]))
+	return FALSE;
+    Retire(m, r[NextPCReg] + 4, 0, 0);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// HandlerFor
+// 	Return the threaded-code handler for an opcode.
+//----------------------------------------------------------------------
+
+static OpHandler
+HandlerFor(int opCode)
+{
+    switch (opCode) {
+      case OP_ADD:	return DoADD;
+      case OP_ADDI:	return DoADDI;
+      case OP_ADDIU:	return DoADDIU;
+      case OP_ADDU:	return DoADDU;
+      case OP_AND:	return DoAND;
+      case OP_ANDI:	return DoANDI;
+      case OP_BEQ:	return DoBEQ;
+      case OP_BGEZ:	return DoBGEZ;
+      case OP_BGTZ:	return DoBGTZ;
+      case OP_BLEZ:	return DoBLEZ;
+      case OP_BLTZ:	return DoBLTZ;
+      case OP_BNE:	return DoBNE;
+      case OP_J:	return DoJ;
+      case OP_JAL:	return DoJAL;
+      case OP_JALR:	return DoJALR;
+      case OP_JR:	return DoJR;
+      case OP_LB:	return DoLB;
+      case OP_LBU:	return DoLB;
+      case OP_LUI:	return DoLUI;
+      case OP_LW:	return DoLW;
+      case OP_MFHI:	return DoMFHI;
+      case OP_MFLO:	return DoMFLO;
+      case OP_MTHI:	return DoMTHI;
+      case OP_MTLO:	return DoMTLO;
+      case OP_MULT:	return DoMULT;
+      case OP_MULTU:	return DoMULTU;
+      case OP_NOR:	return DoNOR;
+      case OP_ORI:	return DoORI;
+      case OP_SB:	return DoSB;
+      case OP_SLL:	return DoSLL;
+      case OP_SLLV:	return DoSLLV;
+      case OP_SLT:	return DoSLT;
+      case OP_SLTI:	return DoSLTI;
+      case OP_SLTIU:	return DoSLTIU;
+      case OP_SLTU:	return DoSLTU;
+      case OP_SRA:	return DoSRA;
+      case OP_SRAV:	return DoSRAV;
+      case OP_SRL:	return DoSRL;
+      case OP_SRLV:	return DoSRLV;
+      case OP_SUB:	return DoSUB;
+      case OP_SUBU:	return DoSUBU;
+      case OP_SW:	return DoSW;
+      case OP_XOR:	return DoXOR;
+      case OP_XORI:	return DoXORI;
+      default:		return DoGeneric;
+    }
+}
+
+//----------------------------------------------------------------------
+// IsBranch
+// 	Does this opcode change the flow of control (so that the basic
+//	block ends with its delay slot)?
+//----------------------------------------------------------------------
+
+static bool
+IsBranch(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ: case OP_BNE: case OP_BGEZ: case OP_BGEZAL:
+      case OP_BGTZ: case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL:
+      case OP_J: case OP_JAL: case OP_JALR: case OP_JR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::DecodePage
+// 	Decode every word of physical page "pageFrame" into decodeCache,
+//	and set up its threaded code: the handler for each word, and the
+//	length of the basic block starting at each word.
+//----------------------------------------------------------------------
+
+#define MaxBlockLength	255	// must fit in blockLength's unsigned char
+
+void
+Machine::DecodePage(int pageFrame)
+{
+    int first = pageFrame * pageSize / 4;
+    int last = first + pageSize / 4 - 1;
+    int i;
+
+    for (i = last; i >= first; i--) {
+	decodeCache[i].value = WordToHost(*(unsigned int *) &mainMemory[i * 4]);
+	decodeCache[i].Decode();
+	threadedCode[i] = HandlerFor(decodeCache[i].opCode);
+	if (i == last)
+	    blockLength[i] = 1;
+	else if (IsBranch(decodeCache[i].opCode))
+	    blockLength[i] = 2;			// the branch and its delay slot
+	else if (blockLength[i + 1] < MaxBlockLength)
+	    blockLength[i] = blockLength[i + 1] + 1;
+	else				// big page: split up long runs
+	    blockLength[i] = 1;
+    }
+    decodeValid[pageFrame] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Execute the basic block starting at the current PC, using the
+//	threaded code for its page.
+//
+//	Simulated time is charged once for the whole block rather than
+//	after every instruction, but interrupts and exceptions still
+//	happen at exactly the same simulated time as with OneInstruction:
+//
+//	  - we only run a block if no interrupt can fall due before its
+//	    last instruction; the OneTick after the last instruction then
+//	    delivers anything due, just as it would have;
+//	  - if an instruction traps, RaiseException first charges the
+//	    instructions of the block that already completed (see
+//	    "uncharged"), and we finish with the usual OneTick for the
+//	    trapping instruction.
+//
+//	When fast-forwarding, even the OneTick at the end of the block
+//	is put off, as long as nothing is due by then (see RunAhead).
+//
+//	Returns FALSE (having done nothing) if the next instruction should
+//	be run by the reference interpreter instead: when we are in a
+//	branch delay slot, or when an interrupt is due too soon.  With a
+//	TLB, we always do: every instruction fetch has to look up the TLB,
+//	as it affects its hit and miss counts and which entry is replaced
+//	next, and the block's fetches would not.
+//----------------------------------------------------------------------
+
+bool
+Machine::RunBlock()
+{
+    int pc = registers[PCReg];
+    int physicalAddress, pageFrame, first, length, i;
+    ExceptionType exception;
+
+    if ((tlb != NULL) || (registers[NextPCReg] != pc + 4))
+	return FALSE;
+
+    exception = Translate(pc, &physicalAddress, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, pc);
+	interrupt->OneTick();
+	return TRUE;
+    }
+    pageFrame = physicalAddress / pageSize;
+    if (!decodeValid[pageFrame])
+	DecodePage(pageFrame);
+    first = physicalAddress / 4;
+    length = blockLength[first];
+    if (stats->totalTicks + (uncharged + length) * UserTick
+			> interrupt->NextDueTime()) {
+	CatchUpTime();
+	return FALSE;
+    }
+
+    for (i = first; i < first + length; i++) {
+	if (!(*threadedCode[i])(this, &decodeCache[i])) {
+	    interrupt->OneTick();		// exception; already charged
+	    return TRUE;			// for the rest of the block
+	}
+	uncharged++;
+	if (!decodeValid[pageFrame])		// the block wrote to its own
+	    break;				// page; re-decode before going on
+    }
+    if (fastForward && (stats->totalTicks + uncharged * UserTick
+			< interrupt->NextDueTime()))
+	return TRUE;				// nothing due yet
+    uncharged--;			// the last instruction is charged by
+    CatchUpTime();			// OneTick, which also delivers
+    interrupt->OneTick();		// anything that is now due
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::RunAhead
+// 	Fast-forward: execute the next instruction without calling
+//	OneTick after it, if no interrupt can be due by the time it
+//	completes.  The instructions run this way are only counted (in
+//	"uncharged"), and charged in one go when we next have to go
+//	through the interrupt machinery: at the instruction that reaches
+//	the next deadline, or when an instruction traps (see
+//	RaiseException).  Simulated time is thus the same as with
+//	OneTick after every instruction.
+//
+//	Returns FALSE (having done nothing but catch up on time) if the
+//	next instruction has to be followed by a OneTick.
+//----------------------------------------------------------------------
+
+bool
+Machine::RunAhead(Instruction *instr)
+{
+    if (stats->totalTicks + (uncharged + 1) * UserTick
+			>= interrupt->NextDueTime()) {
+	CatchUpTime();
+	return FALSE;
+    }
+    if (OneInstruction(instr))
+	uncharged++;
+    else
+	interrupt->OneTick();		// exception; the instructions before
+					// it have already been charged
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Instruction::Decode
 // 	Decode a MIPS instruction 
@@ -20,8 +20,49 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = numCacheEvictions = 0;
+    numTLBHits = numTLBMisses = 0;
+    numPageTableLookups = numPageTableProbes = maxPageTableBytes = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numSpinLockAcquires = numSpinLockWaits = numSpinLockSpins = 0;
+}
+
+//----------------------------------------------------------------------
+// Statistics::Add
+// 	Add the metrics of another simulated CPU to these, to get the
+//	totals for the whole machine.  Its ticks are added too: they
+//	are time spent on that CPU.
+//
+//	"other" -- the other CPU's statistics
+//----------------------------------------------------------------------
+
+void
+Statistics::Add(Statistics *other)
+{
+    totalTicks += other->totalTicks;
+    idleTicks += other->idleTicks;
+    systemTicks += other->systemTicks;
+    userTicks += other->userTicks;
+    numDiskReads += other->numDiskReads;
+    numDiskWrites += other->numDiskWrites;
+    numConsoleCharsRead += other->numConsoleCharsRead;
+    numConsoleCharsWritten += other->numConsoleCharsWritten;
+    numPageFaults += other->numPageFaults;
+    numPacketsSent += other->numPacketsSent;
+    numPacketsRecvd += other->numPacketsRecvd;
+    numCacheHits += other->numCacheHits;
+    numCacheMisses += other->numCacheMisses;
+    numCacheEvictions += other->numCacheEvictions;
+    numTLBHits += other->numTLBHits;
+    numTLBMisses += other->numTLBMisses;
+    numPageTableLookups += other->numPageTableLookups;
+    numPageTableProbes += other->numPageTableProbes;
+    if (other->maxPageTableBytes > maxPageTableBytes)
+	maxPageTableBytes = other->maxPageTableBytes;
+    numSpinLockAcquires += other->numSpinLockAcquires;
+    numSpinLockWaits += other->numSpinLockWaits;
+    numSpinLockSpins += other->numSpinLockSpins;
 }
 
 //----------------------------------------------------------------------
@@ -36,9 +77,16 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    printf("Disk cache: hits %d, misses %d, evictions %d\n", numCacheHits,
+	numCacheMisses, numCacheEvictions);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
+    if (numTLBHits + numTLBMisses > 0)		// if there is a TLB
+	printf("TLB: hits %d, misses %d\n", numTLBHits, numTLBMisses);
+    if (maxPageTableBytes > 0)
+	printf("Page tables: lookups %d, probes %d, peak size %d bytes\n",
+	       numPageTableLookups, numPageTableProbes, maxPageTableBytes);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
@@ -35,9 +35,22 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numCacheHits;		// disk requests found in the buffer cache
+    int numCacheMisses;		// disk requests not found in the cache
+    int numCacheEvictions;	// sectors evicted from the cache
+    int numTLBHits;		// TLB lookups that found the page
+    int numTLBMisses;		// TLB lookups that did not
+    int numPageTableLookups;	// translations done with the page table
+    int numPageTableProbes;	// page table entries read doing them
+    int maxPageTableBytes;	// most memory taken by the page tables
+				// at once, if the kernel measures it
+    int numSpinLockAcquires;	// spinlocks acquired (MULTIPROCESSOR)
+    int numSpinLockWaits;	// of those, ones another CPU was holding
+    int numSpinLockSpins;	// times round the loop waiting for them
 
     Statistics(); 		// initialize everything to zero
 
+    void Add(Statistics *other);	// add in another CPU's statistics
     void Print();		// print collected statistics
 };
 
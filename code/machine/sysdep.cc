@@ -25,6 +25,7 @@
 
 #include "copyright.h"
 #include <unistd.h>
+#include <stdlib.h>
 extern "C" {
 #include <stdio.h>
 #include <string.h>
@@ -36,7 +37,7 @@ extern "C" {
 #include <sys/un.h>
 #include <sys/mman.h>
 #include <sys/errno.h>
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
 #include <sys/time.h>
 #endif
 #ifdef HOST_SPARC
@@ -59,7 +60,7 @@ int open(const char *name, int flags, ...);
 #endif
 #endif
 // void signal(int sig, VoidFunctionPtr func); -- this may work now!
-#if defined(HOST_i386) || defined(HOST_ALPHA)
+#if defined(HOST_i386) || defined(HOST_x86_64) || defined(HOST_ALPHA)
 int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
              struct timeval *timeout);
 #else
@@ -82,11 +83,7 @@ int select(int numBits, void *readFds, void *writeFds, void *exceptFds,
 //extern int sendto(int s, void *msg, int len, int flags, void *to, int tolen);
 
 
-void srand(unsigned seed);
-int rand(void);
 unsigned sleep(unsigned);
-void abort();
-void exit(int);
 int getpagesize();
 
 #ifndef HOST_ALPHA
@@ -135,7 +132,7 @@ PollFile(int fd)
         pollTime.tv_usec = 0;                 	// no delay
 
 // poll file or socket
-#if defined(HOST_i386) || defined(HOST_ALPHA)
+#if defined(HOST_i386) || defined(HOST_x86_64) || defined(HOST_ALPHA)
     retVal = select(32, (fd_set*)&rfd, (fd_set*)&wfd, (fd_set*)&xfd, &pollTime);
 #else
     retVal = select(32, &rfd, &wfd, &xfd, &pollTime);
@@ -238,7 +235,7 @@ Lseek(int fd, int offset, int whence)
 int 
 Tell(int fd)
 {
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
     return lseek(fd,0,SEEK_CUR); // 386BSD doesn't have the tell() system call
 #else
     return tell(fd);
@@ -369,7 +366,7 @@ ReadFromSocket(int sockID, char *buffer, int packetSize)
 
     if (retVal != packetSize) {
         perror("in recvfrom");
-#ifdef HOST_ALPHA
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
         printf("called: %lx, got back %d, %d\n", (long) buffer, retVal, errno);
 #else
         printf("called: %x, got back %d, %d\n", (int) buffer, retVal, errno);
@@ -430,7 +427,7 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
 void 
 CallOnUserAbort(VoidNoArgFunctionPtr func)
 {
-#ifdef HOST_ALPHA
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
     (void)signal(SIGINT, (void (*)(int)) func);
 #else
     (void)signal(SIGINT, (VoidFunctionPtr) func);
@@ -518,6 +515,80 @@ AllocBoundedArray(int size)
     return ptr + pgSize;
 }
 
+//----------------------------------------------------------------------
+// AllocStack
+// 	Return a thread execution stack, with unmapped guard pages just
+//	below and just above it, to catch stack overflows.  Stacks come
+//	from a pool: when it is empty, StacksPerChunk stacks are mapped
+//	at once (page aligned, so the guard pages really are protected),
+//	and stacks given back by DeallocStack are reused as they are.
+//	So a thread-heavy program maps and protects its stacks once,
+//	rather than on every Fork.  The memory is never unmapped.
+//
+//	A free stack holds the next free stack in its first word.  On a
+//	multiprocessor, each CPU has a pool of its own, so no locking
+//	is needed; a stack goes back to the pool of the CPU its thread
+//	finished on.
+//
+//	"size" -- amount of useful space needed (in bytes); it must be
+//		the same for every stack
+//----------------------------------------------------------------------
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define StacksPerChunk	16
+
+static PerCpu char *freeStacks = NULL;	// the pool of unused stacks
+static int stackBytes = 0;		// size of each stack, in whole pages;
+					// set before there is a second CPU
+
+char *
+AllocStack(int size)
+{
+    int pgSize = getpagesize();
+    int slot, i;
+    char *chunk, *ptr;
+
+    if (stackBytes == 0)
+	stackBytes = divRoundUp(size, pgSize) * pgSize;
+    ASSERT(divRoundUp(size, pgSize) * pgSize == stackBytes);
+    if (freeStacks == NULL) {
+	slot = pgSize + stackBytes;		// a guard page, then a stack
+	chunk = (char *) mmap(NULL, StacksPerChunk * slot + pgSize,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+			-1, 0);
+	ASSERT(chunk != (char *) MAP_FAILED);
+	for (i = 0; i <= StacksPerChunk; i++)
+	    mprotect(chunk + i * slot, pgSize, PROT_NONE);
+	for (i = StacksPerChunk - 1; i >= 0; i--) {
+	    ptr = chunk + i * slot + pgSize;
+	    *(char **) ptr = freeStacks;
+	    freeStacks = ptr;
+	}
+    }
+    ptr = freeStacks;
+    freeStacks = *(char **) ptr;
+    return ptr;
+}
+
+//----------------------------------------------------------------------
+// DeallocStack
+// 	Give a stack from AllocStack back to the pool.
+//
+//	"ptr" -- the stack
+//	"size" -- amount of useful space in it (in bytes)
+//----------------------------------------------------------------------
+
+void
+DeallocStack(char *ptr, int size)
+{
+    ASSERT(divRoundUp(size, getpagesize()) * getpagesize() == stackBytes);
+    *(char **) ptr = freeStacks;
+    freeStacks = ptr;
+}
+
 //----------------------------------------------------------------------
 // DeallocBoundedArray
 // 	Deallocate an array of integers, unprotecting its two boundary pages.
@@ -56,13 +56,15 @@ extern int Random();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Allocate, de-allocate a thread execution stack, with unmapped guard
+// pages at either end; stacks are kept in a pool and reused
+extern char *AllocStack(int size);
+extern void DeallocStack(char *p, int size);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
+#include <stdlib.h>		// for atoi, atof, abs
 extern "C" {
-int atoi(const char *str);
-double atof(const char *str);
-int abs(int i);
-
 #include <stdio.h>		// for printf, fprintf
 #include <string.h>		// for DEBUG, etc.
 }
@@ -4,11 +4,17 @@
 //	in the table on every memory reference to find the true physical
 //	memory location.
 //
-// Two types of translation are supported here.
+// Four types of translation are supported here.
 //
 //	Linear page table -- the virtual page # is used as an index
 //	into the table, to find the physical page #.
 //
+//	Two-level page table -- the high bits of the virtual page #
+//	index a directory of leaf tables, the low bits the leaf.
+//
+//	Inverted page table -- one entry per physical page, found by
+//	hashing the address space id and virtual page #.
+//
 //	Translation lookaside buffer -- associative lookup in the table
 //	to find an entry with the same virtual page #.  If found,
 //	this entry is used for the translation.
@@ -90,37 +96,81 @@ Machine::ReadMem(int addr, int size, int *value)
     int data;
     ExceptionType exception;
     int physicalAddress;
+    char *hostAddr;
     
-    DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
+    hostAddr = CachedAddress(addr, size, FALSE);
+    if (hostAddr == NULL) {
+	DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+	exception = Translate(addr, &physicalAddress, size, FALSE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	hostAddr = &machine->mainMemory[physicalAddress];
     }
     switch (size) {
       case 1:
-	data = machine->mainMemory[physicalAddress];
+	data = *hostAddr;
 	*value = data;
 	break;
 	
       case 2:
-	data = *(unsigned short *) &machine->mainMemory[physicalAddress];
+	data = *(unsigned short *) hostAddr;
 	*value = ShortToHost(data);
 	break;
 	
       case 4:
-	data = *(unsigned int *) &machine->mainMemory[physicalAddress];
+	data = *(unsigned int *) hostAddr;
 	*value = WordToHost(data);
 	break;
 
       default: ASSERT(FALSE);
     }
     
-    DEBUG('a', "\tvalue read = %8.8x\n", *value);
+    if (!cacheTranslations)
+	DEBUG('a', "\tvalue read = %8.8x\n", *value);
     return (TRUE);
 }
 
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+//      Fetch the instruction at virtual address "addr" and decode it
+//	into "instr".  The address is translated exactly as ReadMem would
+//	(so use bits get set and page faults are raised as before), but
+//	rather than re-decoding the word every time, we keep a decoded
+//	copy of each physical page that user code executes from.  The
+//	copy of a page is built the first time we fetch from it, and
+//	thrown away when the page is written (see WriteMem and
+//	InvalidateDecodeCache).
+//
+//   	Returns FALSE if the translation step from virtual to physical memory
+//   	failed.
+//----------------------------------------------------------------------
+
+bool
+Machine::FetchInstruction(int addr, Instruction *instr)
+{
+    ExceptionType exception;
+    int physicalAddress;
+    int pageFrame;
+
+    if (!cacheTranslations)
+	DEBUG('a', "Reading VA 0x%x, size %d\n", addr, 4);
+    exception = Translate(addr, &physicalAddress, 4, FALSE);
+    if (exception != NoException) {
+	machine->RaiseException(exception, addr);
+	return FALSE;
+    }
+    pageFrame = physicalAddress / pageSize;
+    if (!decodeValid[pageFrame])
+	DecodePage(pageFrame);
+    *instr = decodeCache[physicalAddress / 4];
+    if (!cacheTranslations)
+	DEBUG('a', "\tvalue read = %8.8x\n", instr->value);
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Machine::WriteMem
 //      Write "size" (1, 2, or 4) bytes of the contents of "value" into
@@ -139,35 +189,96 @@ Machine::WriteMem(int addr, int size, int value)
 {
     ExceptionType exception;
     int physicalAddress;
+    char *hostAddr;
      
-    DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+    hostAddr = CachedAddress(addr, size, TRUE);
+    if (hostAddr == NULL) {
+	DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+	exception = Translate(addr, &physicalAddress, size, TRUE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	hostAddr = &machine->mainMemory[physicalAddress];
     }
     switch (size) {
       case 1:
-	machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
+	*hostAddr = (unsigned char) (value & 0xff);
 	break;
 
       case 2:
-	*(unsigned short *) &machine->mainMemory[physicalAddress]
+	*(unsigned short *) hostAddr
 		= ShortToMachine((unsigned short) (value & 0xffff));
 	break;
       
       case 4:
-	*(unsigned int *) &machine->mainMemory[physicalAddress]
+	*(unsigned int *) hostAddr
 		= WordToMachine((unsigned int) value);
 	break;
 	
       default: ASSERT(FALSE);
     }
+    decodeValid[(hostAddr - mainMemory) / pageSize] = FALSE;
     
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodeCache
+//      Discard the decoded instructions of physical page "pageFrame".
+//	Writes through WriteMem do this automatically; the kernel must
+//	call it when it fills a frame directly (eg, reading a page of the
+//	executable or of the swap file into mainMemory).
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateDecodeCache(int pageFrame)
+{
+    ASSERT((pageFrame >= 0) && (pageFrame < numPhysPages));
+    decodeValid[pageFrame] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslationCache
+//      Empty the translation cache.  Done on every return from an
+//	exception, and must be done by the kernel whenever it changes
+//	the page table or TLB at any other time (eg, on a context switch
+//	in RestoreState).
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTranslationCache()
+{
+    for (int i = 0; i < TransCacheSize; i++)
+	transCache[i].virtualPage = -1;
+}
+
+//----------------------------------------------------------------------
+// Machine::CachedAddress
+//      The fast path of address translation.  If "virtAddr" is suitably
+//	aligned and its page is in the translation cache (and, for a
+//	write, is already known to be writable and dirty), return the
+//	host address of the byte it maps to.  Otherwise return NULL; the
+//	caller must then call Translate, which refills the cache.
+//
+//	"virtAddr" -- the virtual address to translate
+//	"size" -- the amount of memory being read or written
+// 	"writing" -- TRUE for a store
+//----------------------------------------------------------------------
+
+char *
+Machine::CachedAddress(int virtAddr, int size, bool writing)
+{
+    unsigned int vpn = (unsigned) virtAddr >> pageShift;
+    CachedTranslation *cached = &transCache[vpn & (TransCacheSize - 1)];
+
+    if ((cached->virtualPage != (int) vpn) || (virtAddr & (size - 1))
+		|| (writing && !cached->writable))
+	return NULL;
+    return cached->hostAddr + (virtAddr & (pageSize - 1));
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -177,6 +288,9 @@ Machine::WriteMem(int addr, int size, int value)
 //	address in "physAddr".  If there was an error, returns the type
 //	of the exception.
 //
+//	Successful translations are remembered in the translation cache,
+//	which is checked first.
+//
 //	"virtAddr" -- the virtual address to translate
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
@@ -190,6 +304,14 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
+    CachedTranslation *cached;
+    char *hostAddr;
+
+    hostAddr = CachedAddress(virtAddr, size, writing);
+    if (hostAddr != NULL) {
+	*physAddr = hostAddr - mainMemory;
+	return NoException;
+    }
 
     DEBUG('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
 
@@ -199,16 +321,41 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	return AddressErrorException;
     }
     
-    // we must have either a TLB or a page table, but not both!
-    ASSERT(tlb == NULL || pageTable == NULL);	
-    ASSERT(tlb != NULL || pageTable != NULL);	
+    // we must have either a TLB or one page table, but not both!
+    ASSERT((tlb != NULL) + (pageTable != NULL) + (twoLevelTable != NULL)
+		+ (invertedTable != NULL) == 1);
 
 // calculate the virtual page number, and offset within the page,
 // from the virtual address
-    vpn = (unsigned) virtAddr / PageSize;
-    offset = (unsigned) virtAddr % PageSize;
+    vpn = (unsigned) virtAddr / pageSize;
+    offset = (unsigned) virtAddr % pageSize;
     
-    if (tlb == NULL) {		// => page table => vpn is index into table
+    if (twoLevelTable != NULL) {
+	stats->numPageTableLookups++;
+	if (vpn >= twoLevelTable->Size()) {
+	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
+			vpn, twoLevelTable->Size());
+	    return AddressErrorException;
+	}
+	entry = twoLevelTable->Lookup(vpn);
+	stats->numPageTableProbes += (entry == NULL) ? 1 : 2;
+	if (entry == NULL || !entry->valid) {
+	    DEBUG('a', "virtual page # %d not mapped!\n", vpn);
+	    return PageFaultException;
+	}
+    } else if (invertedTable != NULL) {
+	int probes;
+
+	stats->numPageTableLookups++;
+	entry = invertedTable->Lookup(asid, vpn, &probes);
+	stats->numPageTableProbes += probes;
+	if (entry == NULL) {
+	    DEBUG('a', "virtual page # %d not mapped!\n", vpn);
+	    return PageFaultException;
+	}
+    } else if (tlb == NULL) {	// => page table => vpn is index into table
+	stats->numPageTableLookups++;
+	stats->numPageTableProbes++;
 	if (vpn >= pageTableSize) {
 	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
 			virtAddr, pageTableSize);
@@ -219,18 +366,25 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	    return PageFaultException;
 	}
 	entry = &pageTable[vpn];
-    } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && ((unsigned int)tlb[i].virtualPage == vpn)) {
+    } else {			// only look in the page's set
+	int first = (vpn % (tlbSize / tlbWays)) * tlbWays;
+
+	tlbLookups++;
+        for (entry = NULL, i = first; i < first + tlbWays; i++)
+    	    if (tlb[i].valid && ((unsigned int)tlb[i].virtualPage == vpn)
+			&& tlb[i].asid == asid) {
 		entry = &tlb[i];			// FOUND!
+		tlbLastUse[i] = tlbLookups;
 		break;
 	    }
 	if (entry == NULL) {				// not found
     	    DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
+	    stats->numTLBMisses++;
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	stats->numTLBHits++;
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
@@ -241,15 +395,242 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
-	DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
+    if (pageFrame >= (unsigned) numPhysPages) { 
+	DEBUG('a', "*** frame %d > %d!\n", pageFrame, numPhysPages);
 	return BusErrorException;
     }
     entry->use = TRUE;		// set the use, dirty bits
     if (writing)
 	entry->dirty = TRUE;
-    *physAddr = pageFrame * PageSize + offset;
-    ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
+    *physAddr = pageFrame * pageSize + offset;
+    ASSERT((*physAddr >= 0) && ((*physAddr + size) <= memorySize));
     DEBUG('a', "phys addr = 0x%x\n", *physAddr);
+
+    if (cacheTranslations) {		// remember it for next time
+	cached = &transCache[vpn & (TransCacheSize - 1)];
+	cached->virtualPage = vpn;
+	cached->physicalPage = pageFrame;
+	cached->hostAddr = &mainMemory[pageFrame * pageSize];
+	cached->writable = !entry->readOnly && entry->dirty;
+    }
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// TwoLevelPageTable::TwoLevelPageTable
+// 	Initialize an empty two-level page table, for an address space
+//	of "numPages" pages.  Only the directory is allocated.
+//----------------------------------------------------------------------
+
+TwoLevelPageTable::TwoLevelPageTable(int size)
+{
+    ASSERT(size > 0);
+    numPages = size;
+    numLeaves = divRoundUp(size, PageTableLeafSize);
+    directory = new TranslationEntry *[numLeaves];
+    for (int i = 0; i < numLeaves; i++)
+	directory[i] = NULL;
+    leavesAllocated = 0;
+}
+
+//----------------------------------------------------------------------
+// TwoLevelPageTable::~TwoLevelPageTable
+// 	De-allocate the directory and the leaves.
+//----------------------------------------------------------------------
+
+TwoLevelPageTable::~TwoLevelPageTable()
+{
+    for (int i = 0; i < numLeaves; i++)
+	if (directory[i] != NULL)
+	    delete [] directory[i];
+    delete [] directory;
+}
+
+//----------------------------------------------------------------------
+// TwoLevelPageTable::Lookup
+// 	Return the entry of virtual page "vpn", or NULL if no page of
+//	its leaf has ever been mapped (in which case it isn't valid).
+//----------------------------------------------------------------------
+
+TranslationEntry *
+TwoLevelPageTable::Lookup(unsigned int vpn)
+{
+    ASSERT(vpn < numPages);
+    if (directory[vpn / PageTableLeafSize] == NULL)
+	return NULL;
+    return &directory[vpn / PageTableLeafSize][vpn % PageTableLeafSize];
+}
+
+//----------------------------------------------------------------------
+// TwoLevelPageTable::Entry
+// 	Return the entry of virtual page "vpn", allocating its leaf,
+//	with every entry invalid, if it doesn't have one yet.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+TwoLevelPageTable::Entry(unsigned int vpn)
+{
+    TranslationEntry *leaf;
+
+    ASSERT(vpn < numPages);
+    if (directory[vpn / PageTableLeafSize] == NULL) {
+	leaf = new TranslationEntry[PageTableLeafSize];
+	for (int i = 0; i < PageTableLeafSize; i++) {
+	    leaf[i].virtualPage = (vpn / PageTableLeafSize) * PageTableLeafSize
+				    + i;
+	    leaf[i].physicalPage = -1;
+	    leaf[i].valid = FALSE;
+	    leaf[i].use = FALSE;
+	    leaf[i].dirty = FALSE;
+	    leaf[i].readOnly = FALSE;
+	    leaf[i].asid = 0;
+	}
+	directory[vpn / PageTableLeafSize] = leaf;
+	leavesAllocated++;
+    }
+    return Lookup(vpn);
+}
+
+//----------------------------------------------------------------------
+// TwoLevelPageTable::Bytes
+// 	Return the memory taken up by the directory and the leaves.
+//----------------------------------------------------------------------
+
+int
+TwoLevelPageTable::Bytes()
+{
+    return numLeaves * sizeof(TranslationEntry *)
+	    + leavesAllocated * PageTableLeafSize * sizeof(TranslationEntry);
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::InvertedPageTable
+// 	Initialize an inverted page table for "numFrames" physical
+//	pages, with nothing mapped.
+//----------------------------------------------------------------------
+
+InvertedPageTable::InvertedPageTable(int frames)
+{
+    int i;
+
+    numFrames = frames;
+    entries = new TranslationEntry[numFrames];
+    next = new int[numFrames];
+    for (i = 0; i < numFrames; i++) {
+	entries[i].physicalPage = i;
+	entries[i].valid = FALSE;
+	next[i] = -1;
+    }
+    for (numAnchors = 1; numAnchors < numFrames; numAnchors *= 2)
+	;
+    anchor = new int[numAnchors];
+    for (i = 0; i < numAnchors; i++)
+	anchor[i] = -1;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::~InvertedPageTable
+// 	De-allocate the table.
+//----------------------------------------------------------------------
+
+InvertedPageTable::~InvertedPageTable()
+{
+    delete [] entries;
+    delete [] next;
+    delete [] anchor;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Hash
+// 	Return the anchor slot of page "vpn" of address space "asid".
+//	The multiplier spreads the pages of one space, which are often
+//	consecutive, and of different spaces over the whole anchor table.
+//----------------------------------------------------------------------
+
+int
+InvertedPageTable::Hash(int asid, unsigned int vpn)
+{
+    unsigned int key = (vpn ^ ((unsigned) asid << 20)) * 2654435761u;
+
+    return (key >> 8) & (numAnchors - 1);
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Lookup
+// 	Return the entry mapping page "vpn" of address space "asid",
+//	or NULL if that page isn't in memory.
+//
+//	"probes" -- set to the # of table slots read: the anchor, and
+//		each entry on the chain
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedPageTable::Lookup(int asid, unsigned int vpn, int *probes)
+{
+    int frame;
+
+    *probes = 1;
+    for (frame = anchor[Hash(asid, vpn)]; frame != -1; frame = next[frame]) {
+	(*probes)++;
+	if (entries[frame].asid == asid
+		&& (unsigned int) entries[frame].virtualPage == vpn)
+	    return &entries[frame];
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Insert
+// 	Map page "vpn" of address space "asid" to physical page "frame",
+//	which must not be mapped already, and return its entry.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedPageTable::Insert(int asid, unsigned int vpn, int frame)
+{
+    int slot = Hash(asid, vpn);
+    TranslationEntry *entry = &entries[frame];
+
+    ASSERT((frame >= 0) && (frame < numFrames) && !entry->valid);
+    entry->virtualPage = vpn;
+    entry->asid = asid;
+    entry->valid = TRUE;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    entry->readOnly = FALSE;
+    next[frame] = anchor[slot];
+    anchor[slot] = frame;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Remove
+// 	Unmap the page in physical page "frame".
+//----------------------------------------------------------------------
+
+void
+InvertedPageTable::Remove(int frame)
+{
+    TranslationEntry *entry = &entries[frame];
+    int *link;
+
+    ASSERT((frame >= 0) && (frame < numFrames) && entry->valid);
+    for (link = &anchor[Hash(entry->asid, entry->virtualPage)];
+		*link != frame; link = &next[*link])
+	ASSERT(*link != -1);
+    *link = next[frame];
+    next[frame] = -1;
+    entry->valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Bytes
+// 	Return the memory taken up by the table.
+//----------------------------------------------------------------------
+
+int
+InvertedPageTable::Bytes()
+{
+    return numFrames * (sizeof(TranslationEntry) + sizeof(int))
+	    + numAnchors * sizeof(int);
+}
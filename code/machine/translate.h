@@ -40,6 +40,73 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
+    int asid;		// In the TLB: the address space the entry belongs
+			// to.  It only matches while machine->asid is the
+			// same, so the TLB need not be flushed when the
+			// address space changes.
+};
+
+// The following class defines a two-level page table, for address
+// spaces that are large but sparse (eg, code and data at the bottom,
+// the stack at the top, and nothing in between).  The virtual page #
+// indexes a directory of pointers to leaf tables of PageTableLeafSize
+// entries; a leaf is only allocated once a page in it is mapped, so
+// the unused parts of the address space cost one pointer per leaf.
+
+#define PageTableLeafSize	32	// entries per leaf table
+
+class TwoLevelPageTable {
+  public:
+    TwoLevelPageTable(int numPages);	// an empty table for pages
+					// 0 .. numPages-1
+    ~TwoLevelPageTable();
+
+    TranslationEntry *Lookup(unsigned int vpn);
+					// The entry of "vpn", or NULL if
+					// its leaf has not been allocated
+    TranslationEntry *Entry(unsigned int vpn);
+					// The entry of "vpn", allocating its
+					// leaf (all invalid) if need be
+    unsigned int Size() { return numPages; }
+    int Bytes();			// memory the table takes up
+
+  private:
+    unsigned int numPages;
+    int numLeaves;			// # of entries of the directory
+    TranslationEntry **directory;	// the leaves, or NULL
+    int leavesAllocated;
+};
+
+// The following class defines a hashed inverted page table: one entry
+// per physical frame, for all address spaces together, so its size
+// depends on the size of memory rather than of the address spaces.
+// The entry mapping (asid, vpn), if any, is found by hashing them into
+// an anchor table, whose slots each start a chain of frames.
+
+class InvertedPageTable {
+  public:
+    InvertedPageTable(int numFrames);	// an empty table
+    ~InvertedPageTable();
+
+    TranslationEntry *Lookup(int asid, unsigned int vpn, int *probes);
+					// The entry mapping page "vpn" of
+					// address space "asid", or NULL;
+					// "probes" is set to the # of table
+					// entries looked at to find out
+    TranslationEntry *Insert(int asid, unsigned int vpn, int frame);
+					// Map page "vpn" of "asid" to "frame"
+    void Remove(int frame);		// Unmap the page in "frame"
+    int Bytes();			// memory the table takes up
+
+  private:
+    int numFrames;
+    TranslationEntry *entries;		// the mapping of each frame
+    int *next;				// the next frame on the same chain,
+					// or -1
+    int numAnchors;			// a power of 2, >= numFrames
+    int *anchor;			// the first frame on each chain, or -1
+
+    int Hash(int asid, unsigned int vpn);
 };
 
 #endif
@@ -17,6 +17,14 @@
 // re-set the interrupt state back to its original value (whether
 // that be disabled or enabled).
 //
+// On a multiprocessor, turning off interrupts only keeps out other
+// threads on the same CPU, so each semaphore and condition also has
+// a spinlock to keep out the other CPUs.  A thread going to sleep
+// takes the lock of its CPU's ready queue before letting go of the
+// spinlock, so that it is off the CPU before anyone can put it back
+// on that queue.  Spinlocks are always taken in the order: condition,
+// semaphore, ready queue.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -65,14 +73,20 @@ void
 Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    spinLock.Acquire();				// and keep out other CPUs
     
     while (value == 0) { 			// semaphore not available
 	queue->Append((void *)currentThread);	// so go to sleep
+	scheduler->Lock();
+	spinLock.Release();
 	currentThread->Sleep();
+	scheduler->Unlock();
+	spinLock.Acquire();
     } 
     value--; 					// semaphore available, 
 						// consume its value
     
+    spinLock.Release();
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
 
@@ -89,11 +103,13 @@ Semaphore::V()
 {
     Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    spinLock.Acquire();
 
     thread = (Thread *)queue->Remove();
     if (thread != NULL)	   // make thread ready, consuming the V immediately
 	scheduler->ReadyToRun(thread);
     value++;
+    spinLock.Release();
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -208,13 +224,17 @@ void Condition::Wait(Lock* conditionLock)
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
     ASSERT(conditionLock->isHeldByCurrentThread());  // check pre-condition
+    spinLock.Acquire();
     if(queue->IsEmpty()) {
 	lock = conditionLock;  // helps to enforce pre-condition
     } 
     ASSERT(lock == conditionLock); // another pre-condition
     queue->Append(currentThread);  // add this thread to the waiting list
     conditionLock->Release();      // release the lock
+    scheduler->Lock();
+    spinLock.Release();
     currentThread->Sleep();        // goto sleep
+    scheduler->Unlock();
     conditionLock->Acquire();      // awaken: re-acquire the lock
     (void) interrupt->SetLevel(oldLevel);
 }
@@ -232,11 +252,13 @@ void Condition::Signal(Lock* conditionLock)
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
     ASSERT(conditionLock->isHeldByCurrentThread());
+    spinLock.Acquire();
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
 	nextThread = (Thread *)queue->Remove();
 	scheduler->ReadyToRun(nextThread);      // wake up the thread
     } 
+    spinLock.Release();
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -253,12 +275,14 @@ void Condition::Broadcast(Lock* conditionLock)
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
     ASSERT(conditionLock->isHeldByCurrentThread());
+    spinLock.Acquire();
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
 	while( (nextThread = (Thread *)queue->Remove()) ) {
 	    scheduler->ReadyToRun(nextThread);  // wake up the thread
 	}
     } 
+    spinLock.Release();
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -9,9 +9,14 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-sp <fifo|priority|heap|mlfq> -sq <quantum,...> -sb <period>
+//		-cpus <# CPUs>
+//		-s -bb -ff -np <# pages> -ps <page size> -tlb <# TLB entries>
+//		-tlbw <# ways>
+//		-x <nachos file> -c <consoleIn> <consoleOut>
+//		-f -bc <# cache sectors> -wb -ds <fifo|scan|clook>
+//		-cp <unix file> <nachos file>
+//		-p <nachos file> -r <nachos file> -l -D -t -tc <# threads>
 //              -n <network reliability> -e <network orderability>
 //              -m <machine id>
 //              -o <other machine id>
@@ -19,21 +24,51 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sp sets the order ready threads run in: fifo (the default), or
+//	lowest priority # first, from a bitmap of per-priority queues
+//	(priority) or from a heap (heap), or from a multi-level feedback
+//	queue (mlfq), in which a thread moves down a level each time it
+//	uses up its quantum, and back to the top when woken up by a device
+//    -sq sets the quantum of each level of the feedback queue, in timer
+//	interrupts, from the top (default 1,2,4,8)
+//    -sb sets the # of timer interrupts between moving every thread back
+//	up to the top level (default 50)
 //    -z prints the copyright message
 //
+//  MULTIPROCESSOR
+//    -cpus runs the kernel on that many simulated CPUs, each on a host
+//	thread of its own (default 1), with a ready queue of its own;
+//	a CPU with nothing to run steals from the longest of the others
+//
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs a basic block at a time, as threaded code
+//    -ff only checks for interrupts when one is due (same simulated time)
+//    -np, -ps set the number of physical pages and the page size of the
+//	simulated machine
 //    -x runs a user program
 //    -c tests the console
 //
+//  VM
+//    -tlb sets the number of TLB entries of the simulated machine (0,
+//	the default unless built with USE_TLB, means none); the kernel
+//	refills the TLB from the page table on a miss.  With a TLB, -bb
+//	has no effect, as every instruction fetch must look it up
+//    -tlbw sets the associativity of the TLB (at least 2; default: fully
+//	associative)
+//
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -bc sets the size of the disk buffer cache (0 turns it off)
+//    -wb makes the buffer cache write-back rather than write-through
+//    -ds sets the order in which queued disk requests are served
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -tc tests the disk with several threads reading files at once
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -60,6 +95,7 @@
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
+extern void ConcurrentTest(int numThreads);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
 extern void SynchTest(void);
@@ -135,6 +171,10 @@ main(int argc, char **argv)
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-tc")) {	// concurrent read test
+	    ASSERT(argc > 1);
+	    ConcurrentTest(atoi(*(argv + 1)));
+	    argCount = 2;
 	}
 #endif // FILESYS
 #ifdef NETWORK
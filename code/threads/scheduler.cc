@@ -4,15 +4,18 @@
 //
 // 	These routines assume that interrupts are already disabled.
 //	If interrupts are disabled, we can assume mutual exclusion
-//	(since we are on a uniprocessor).
+//	(since we are on a uniprocessor).  On a multiprocessor, they
+//	also assume the lock of this CPU's ready queue is held.
 //
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would 
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	By default, no priorities, straight FIFO.  With a priority
+//	policy (-sp), the thread with the lowest priority # runs first.
+//	With a multi-level feedback queue (-sp mlfq), a thread's priority
+//	# is its level, which is set by the scheduler as the thread runs.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -22,30 +25,328 @@
 #include "scheduler.h"
 #include "system.h"
 
+//----------------------------------------------------------------------
+// ReadyQueue::ReadyQueue
+// 	Initialize an empty queue of ready threads.
+//
+//	"queuePolicy" -- the order in which they are to be taken off
+//----------------------------------------------------------------------
+
+ReadyQueue::ReadyQueue(SchedulePolicy queuePolicy)
+{
+    policy = queuePolicy;
+    numThreads = 0;
+    nextOrder = 0;
+    fifo = NULL;
+    queues = NULL;
+    heap = NULL;
+    switch (policy) {
+      case ScheduleFIFO:
+	fifo = new List;
+	break;
+
+      case SchedulePriority:
+      case ScheduleMLFQ:
+	queues = new List *[NumPriorities];
+	for (int i = 0; i < NumPriorities; i++)
+	    queues[i] = new List;
+	for (int i = 0; i < PriorityWords; i++)
+	    nonEmpty[i] = 0;
+	nonEmptyWords = 0;
+	break;
+
+      case SchedulePriorityHeap:
+	maxThreads = 8;
+	heap = new ReadyEntry[maxThreads];
+	break;
+    }
+}
+
+//----------------------------------------------------------------------
+// ReadyQueue::~ReadyQueue
+// 	De-allocate the queue (but not the threads on it).
+//----------------------------------------------------------------------
+
+ReadyQueue::~ReadyQueue()
+{
+    delete fifo;
+    if (queues != NULL) {
+	for (int i = 0; i < NumPriorities; i++)
+	    delete queues[i];
+	delete [] queues;
+    }
+    delete [] heap;
+}
+
+//----------------------------------------------------------------------
+// ReadyQueue::Before
+// 	Return TRUE if the thread of "a" is to run before that of "b":
+//	it has a lower priority #, or the same and was put on first.
+//----------------------------------------------------------------------
+
+bool
+ReadyQueue::Before(ReadyEntry *a, ReadyEntry *b)
+{
+    if (a->priority != b->priority)
+	return (a->priority < b->priority);
+    return (a->order < b->order);
+}
+
+//----------------------------------------------------------------------
+// ReadyQueue::Append
+// 	Put a thread on the queue.  With SchedulePriority it goes at the
+//	end of the FIFO of its priority, whose bit is set in the bitmap;
+//	with SchedulePriorityHeap it is sifted up the heap, growing the
+//	heap if it is full.
+//----------------------------------------------------------------------
+
+void
+ReadyQueue::Append(Thread *thread)
+{
+    int priority = thread->getPriority();
+    ReadyEntry entry;
+    int i, parent;
+
+    ASSERT((priority >= 0) && (priority < NumPriorities));
+    numThreads++;
+    switch (policy) {
+      case ScheduleFIFO:
+	fifo->Append((void *)thread);
+	break;
+
+      case SchedulePriority:
+      case ScheduleMLFQ:
+	queues[priority]->Append((void *)thread);
+	nonEmpty[priority / BitsPerWord] |= 1u << (priority % BitsPerWord);
+	nonEmptyWords |= 1u << (priority / BitsPerWord);
+	break;
+
+      case SchedulePriorityHeap:
+	if (numThreads > maxThreads) {
+	    ReadyEntry *bigger = new ReadyEntry[maxThreads * 2];
+
+	    for (i = 0; i < maxThreads; i++)
+		bigger[i] = heap[i];
+	    delete [] heap;
+	    heap = bigger;
+	    maxThreads *= 2;
+	}
+	entry.thread = thread;
+	entry.priority = priority;
+	entry.order = nextOrder++;
+	for (i = numThreads - 1; i > 0; i = parent) {
+	    parent = (i - 1) / 2;
+	    if (!Before(&entry, &heap[parent]))
+		break;
+	    heap[i] = heap[parent];
+	}
+	heap[i] = entry;
+	break;
+    }
+}
+
+//----------------------------------------------------------------------
+// ReadyQueue::Remove
+// 	Take the thread to run next off the queue.  With SchedulePriority
+//	the first set bit of the bitmap gives its priority, in two
+//	find-first-set operations: one on the summary word, one on the
+//	word it points to.  With SchedulePriorityHeap, the last element
+//	is sifted down to fill the hole at the top.
+//
+// Returns:
+//	The thread, or NULL if the queue is empty.
+//----------------------------------------------------------------------
+
+Thread *
+ReadyQueue::Remove()
+{
+    Thread *thread;
+    ReadyEntry last;
+    int i, w, priority, child;
+
+    if (numThreads == 0)
+	return NULL;
+    numThreads--;
+    switch (policy) {
+      case ScheduleFIFO:
+	return (Thread *)fifo->Remove();
+
+      case SchedulePriority:
+      case ScheduleMLFQ:
+	w = __builtin_ctz(nonEmptyWords);
+	priority = w * BitsPerWord + __builtin_ctz(nonEmpty[w]);
+	thread = (Thread *)queues[priority]->Remove();
+	if (queues[priority]->IsEmpty()) {
+	    nonEmpty[w] &= ~(1u << (priority % BitsPerWord));
+	    if (nonEmpty[w] == 0)
+		nonEmptyWords &= ~(1u << w);
+	}
+	return thread;
+
+      case SchedulePriorityHeap:
+	thread = heap[0].thread;
+	last = heap[numThreads];
+	for (i = 0; (child = 2 * i + 1) < numThreads; i = child) {
+	    if ((child + 1 < numThreads) && Before(&heap[child + 1], &heap[child]))
+		child++;
+	    if (!Before(&heap[child], &last))
+		break;
+	    heap[i] = heap[child];
+	}
+	heap[i] = last;
+	return thread;
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// ReadyQueue::FirstPriority
+// 	Return the priority of the thread that is to run next, without
+//	taking it off the queue, or NumPriorities if the queue is empty.
+//	Only kept for the policies that order threads by priority.
+//----------------------------------------------------------------------
+
+int
+ReadyQueue::FirstPriority()
+{
+    int w;
+
+    if (numThreads == 0)
+	return NumPriorities;
+    switch (policy) {
+      case SchedulePriority:
+      case ScheduleMLFQ:
+	w = __builtin_ctz(nonEmptyWords);
+	return w * BitsPerWord + __builtin_ctz(nonEmpty[w]);
+
+      case SchedulePriorityHeap:
+	return heap[0].priority;
+
+      default:
+	ASSERT(FALSE);
+    }
+    return NumPriorities;
+}
+
+//----------------------------------------------------------------------
+// ReadyQueue::Mapcar
+// 	Call "func" on each thread on the queue, in the order they are to
+//	run.  Only used for debugging, so we don't mind sorting a copy of
+//	the heap to do it.
+//----------------------------------------------------------------------
+
+void
+ReadyQueue::Mapcar(VoidFunctionPtr func)
+{
+    switch (policy) {
+      case ScheduleFIFO:
+	fifo->Mapcar(func);
+	break;
+
+      case SchedulePriority:
+      case ScheduleMLFQ:
+	for (int p = 0; p < NumPriorities; p++)
+	    queues[p]->Mapcar(func);
+	break;
+
+      case SchedulePriorityHeap: {
+	ReadyEntry *sorted = new ReadyEntry[numThreads + 1];
+	ReadyEntry entry;
+	int i, j;
+
+	for (i = 0; i < numThreads; i++) {	// insertion sort
+	    entry = heap[i];
+	    for (j = i; (j > 0) && Before(&entry, &sorted[j - 1]); j--)
+		sorted[j] = sorted[j - 1];
+	    sorted[j] = entry;
+	}
+	for (i = 0; i < numThreads; i++)
+	    (*func)((_int) sorted[i].thread);
+	delete [] sorted;
+	break;
+      }
+    }
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
-// 	Initialize the list of ready but not running threads to empty.
+// 	Initialize the queues of ready but not running threads to empty.
+//
+//	"schedulePolicy" -- the order in which ready threads get the CPU
+//	"levels" -- for ScheduleMLFQ, the # of levels
+//	"levelQuanta" -- the quantum of each level, in timer interrupts;
+//		if NULL, the top level's is 1, and each other's twice the
+//		one above's
+//	"period" -- the # of timer interrupts between moving every
+//		thread up to the top level
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulePolicy schedulePolicy, int levels,
+		     int *levelQuanta, int period)
 { 
-    readyList = new List; 
+    ASSERT((levels >= 1) && (levels <= MaxLevels));
+    ASSERT(period >= 1);
+    policy = schedulePolicy;
+    numLevels = levels;
+    for (int i = 0; i < numLevels; i++) {
+	quanta[i] = (levelQuanta == NULL) ? (1 << i) : levelQuanta[i];
+	ASSERT(quanta[i] >= 1);
+    }
+    boostPeriod = period;
+
+    for (int i = 0; i < MaxCpus; i++) {
+	cpus[i].threads = new ReadyQueue(policy);
+	cpus[i].appends = cpus[i].lengthSum = cpus[i].longest = 0;
+	cpus[i].stealTries = cpus[i].steals = cpus[i].lost = 0;
+	cpus[i].migrations = 0;
+	cpus[i].sliceTicks = cpus[i].boostTicks = 0;
+	cpus[i].demotions = cpus[i].wakeBoosts = cpus[i].boosts = 0;
+    }
 } 
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
-// 	De-allocate the list of ready threads.
+// 	De-allocate the queues of ready threads.
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    for (int i = 0; i < MaxCpus; i++)
+	delete cpus[i].threads;
 } 
 
+//----------------------------------------------------------------------
+// Scheduler::Lock, Scheduler::Unlock
+// 	Acquire and release the lock of the ready queue of the CPU we
+//	are on.  Without MULTIPROCESSOR they do nothing.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Lock()
+{
+    cpus[currentCpu].lock.Acquire();
+}
+
+void
+Scheduler::Unlock()
+{
+    cpus[currentCpu].lock.Release();
+}
+
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
-//	Put it on the ready list, for later scheduling onto the CPU.
+//	Put it on the ready queue, for later scheduling onto the CPU.
+//
+//	On a multiprocessor, it goes on the queue of the CPU it last
+//	ran on, whose cache may still hold its data.  For the running
+//	thread (from Thread::Yield), that is this CPU's queue, and the
+//	caller already holds the lock, which it must keep until it is
+//	off the thread's stack; any other thread, we lock the queue for.
+//
+//	With ScheduleMLFQ, a new thread starts at the top level, as does
+//	one woken up by an interrupt handler: a thread that was waiting
+//	for I/O.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -53,24 +354,138 @@ Scheduler::~Scheduler()
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
+    CpuReadyQueue *cpu = &cpus[0];
+    bool isNew = (thread->getStatus() == JUST_CREATED);
+    int length;
+
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
+#ifdef MULTIPROCESSOR
+    cpu = &cpus[thread->getCpu()];
+    if (thread != currentThread)
+	cpu->lock.Acquire();
+#endif
+    if (policy == ScheduleMLFQ) {
+	if (isNew || (thread->getPriority() >= numLevels))
+	    thread->setPriority(0);
+	else if (interrupt->isInHandler() && (thread->getPriority() > 0)) {
+	    thread->setPriority(0);
+	    cpu->wakeBoosts++;
+	}
+    }
+    cpu->threads->Append(thread);
+    length = cpu->threads->Length();
+    cpu->appends++;
+    cpu->lengthSum += length;
+    if (length > cpu->longest)
+	cpu->longest = length;
+#ifdef MULTIPROCESSOR
+    if (thread != currentThread)
+	cpu->lock.Release();
+#endif
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-// 	Return the next thread to be scheduled onto the CPU.
-//	If there are no ready threads, return NULL.
+// 	Return the next thread on this CPU's queue to be scheduled onto
+//	the CPU.  If there are no ready threads, return NULL.
 // Side effect:
-//	Thread is removed from the ready list.
+//	Thread is removed from the ready queue.
 //----------------------------------------------------------------------
 
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    return cpus[currentCpu].threads->Remove();
+}
+
+#ifdef MULTIPROCESSOR
+//----------------------------------------------------------------------
+// Scheduler::Steal
+// 	Called by a CPU with nothing to run: take the thread to run next
+//	off the longest of the other CPUs' queues.  We are holding our
+//	own queue's lock, so to avoid deadlock with a CPU stealing from
+//	us, we only try for the other's lock, and give up if it is held.
+//
+//	Returns the thread, or NULL if there was none we could take.
+// Side effect:
+//	Thread is removed from the other CPU's ready queue.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::Steal()
+{
+    CpuReadyQueue *cpu = &cpus[currentCpu];
+    CpuReadyQueue *busiest = NULL;
+    Thread *thread = NULL;
+    int longest = 0, length;
+
+    for (int i = 0; i < numCpus; i++) {		// lengths are only hints
+	length = cpus[i].threads->Length();
+	if ((i != currentCpu) && (length > longest)) {
+	    busiest = &cpus[i];
+	    longest = length;
+	}
+    }
+    if (busiest == NULL)
+	return NULL;
+
+    cpu->stealTries++;
+    if (busiest->lock.TryAcquire()) {
+	thread = busiest->threads->Remove();
+	if (thread != NULL)
+	    busiest->lost++;
+	busiest->lock.Release();
+    }
+    if (thread != NULL) {
+	cpu->steals++;
+	DEBUG('t', "CPU %d stealing thread %s from CPU %d\n", currentCpu,
+	      thread->getName(), thread->getCpu());
+    }
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::LockAll, Scheduler::UnlockAll
+// 	Acquire and release the locks of all the ready queues, so as to
+//	see them all at one moment.  To avoid deadlock, the locks are
+//	always taken in order, and the caller must hold none of them.
+//----------------------------------------------------------------------
+
+void
+Scheduler::LockAll()
+{
+    for (int i = 0; i < numCpus; i++)
+	cpus[i].lock.Acquire();
+}
+
+void
+Scheduler::UnlockAll()
+{
+    for (int i = numCpus - 1; i >= 0; i--)
+	cpus[i].lock.Release();
+}
+#endif
+
+//----------------------------------------------------------------------
+// Scheduler::IsEmpty
+// 	Return TRUE if no thread is ready to run, on any CPU.  Unless
+//	the caller holds all the queues' locks, the answer may be out
+//	of date by the time it is used.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::IsEmpty()
+{
+#ifdef MULTIPROCESSOR
+    for (int i = 0; i < numCpus; i++)
+	if (!cpus[i].threads->IsEmpty())
+	    return FALSE;
+    return TRUE;
+#else
+    return cpus[0].threads->IsEmpty();
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -81,6 +496,10 @@ Scheduler::FindNextToRun ()
 //
 //      Note: we assume the state of the previously running thread has
 //	already been changed from running to blocked or ready (depending).
+//
+//	On a multiprocessor, this CPU's queue lock is held across SWITCH,
+//	so no other CPU can pick the old thread off the ready list before
+//	we are off its stack; whichever thread we switch to releases it.
 // Side effect:
 //	The global variable currentThread becomes nextThread.
 //
@@ -102,6 +521,14 @@ Scheduler::Run (Thread *nextThread)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+#ifdef MULTIPROCESSOR
+    if (nextThread->getCpu() != currentCpu) {	// it last ran elsewhere
+	cpus[currentCpu].migrations++;
+	nextThread->setCpu(currentCpu);
+    }
+#endif
+    cpus[currentCpu].sliceTicks = 0;	    // nextThread starts a quantum
+
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
     
@@ -134,14 +561,136 @@ Scheduler::Run (Thread *nextThread)
 #endif
 }
 
+//----------------------------------------------------------------------
+// Scheduler::Tick
+// 	Called on each timer interrupt, with interrupts off, to decide
+//	whether the running thread is to give up the CPU.  Except with
+//	ScheduleMLFQ, it always is: each thread gets one timer interval.
+//
+//	With ScheduleMLFQ, the running thread is charged for the
+//	interrupt.  Once it has had its level's quantum of them, it is
+//	moved down a level, and gives up the CPU; before then, it does
+//	only if a thread of a higher level is ready.  Every boostPeriod
+//	interrupts, the threads on this CPU are moved to the top level,
+//	so that CPU-bound threads don't starve, and a thread that has
+//	become interactive is treated as such again.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::Tick()
+{
+    CpuReadyQueue *cpu = &cpus[currentCpu];
+    int level;
+    bool yield;
+
+    if (policy != ScheduleMLFQ)
+	return TRUE;
+
+    cpu->lock.Acquire();
+    if (++cpu->boostTicks == boostPeriod) {
+	cpu->boostTicks = 0;
+	Boost(cpu);
+    }
+    level = currentThread->getPriority();
+    if (level >= numLevels)		// (the main thread, until it
+	currentThread->setPriority(level = 0);	// first gives up the CPU)
+    if (++cpu->sliceTicks >= quanta[level]) {
+	cpu->sliceTicks = 0;
+	if (level < numLevels - 1) {
+	    DEBUG('t', "Moving thread \"%s\" down to level %d\n",
+		  currentThread->getName(), level + 1);
+	    currentThread->setPriority(level + 1);
+	    cpu->demotions++;
+	}
+	yield = TRUE;
+    } else
+	yield = (cpu->threads->FirstPriority() < level);
+    cpu->lock.Release();
+    return yield;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Move the running thread, and the threads ready to run on this
+//	CPU, up to the top level, keeping them in the order they would
+//	have run in.  Threads that are blocked keep their level until
+//	they next run here (or are woken by a device).
+//
+//	"cpu" is this CPU's queue, whose lock we hold.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost(CpuReadyQueue *cpu)
+{
+    List boosted;
+    Thread *thread;
+
+    DEBUG('t', "Moving all threads up to the top level\n");
+    while ((thread = cpu->threads->Remove()) != NULL)
+	boosted.Append((void *)thread);
+    while ((thread = (Thread *)boosted.Remove()) != NULL) {
+	thread->setPriority(0);
+	cpu->threads->Append(thread);
+    }
+    currentThread->setPriority(0);
+    cpu->boosts++;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Print
 // 	Print the scheduler state -- in other words, the contents of
-//	the ready list.  For debugging.
+//	the ready queue, in the order they will run.  For debugging.
+//	On a multiprocessor, only this CPU's queue is printed.
 //----------------------------------------------------------------------
 void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    cpus[currentCpu].threads->Mapcar((VoidFunctionPtr) ThreadPrint);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PrintStats
+// 	Print, for each CPU's ready queue on a multiprocessor, how many
+//	threads went through it and how long it got; how often the CPU
+//	stole threads from others, and others from it; how many threads
+//	moved to the CPU from another; and how contended the queue's
+//	lock was.  With ScheduleMLFQ, print how often threads changed
+//	level.  Otherwise, print nothing.
+//----------------------------------------------------------------------
+
+void
+Scheduler::PrintStats()
+{
+    CpuReadyQueue *cpu;
+    int n = 1, demotions = 0, wakeBoosts = 0, boosts = 0;
+
+#ifdef MULTIPROCESSOR
+    char name[32];
+
+    n = numCpus;
+    for (int i = 0; (n > 1) && (i < n); i++) {
+	cpu = &cpus[i];
+	printf("Ready queue %d: queued %d, longest %d, mean length %.2f; "
+	       "stole %d in %d tries, lost %d, migrations %d\n", i,
+	       cpu->appends, cpu->longest, (cpu->appends == 0) ? 0.0 :
+	       (double) cpu->lengthSum / cpu->appends, cpu->steals,
+	       cpu->stealTries, cpu->lost, cpu->migrations);
+	sprintf(name, "Ready queue %d lock", i);
+	cpu->lock.Print(name);
+    }
+#endif
+    if (policy != ScheduleMLFQ)
+	return;
+    for (int i = 0; i < n; i++) {
+	cpu = &cpus[i];
+	demotions += cpu->demotions;
+	wakeBoosts += cpu->wakeBoosts;
+	boosts += cpu->boosts;
+    }
+    printf("Feedback queue: %d levels, quanta", numLevels);
+    for (int i = 0; i < numLevels; i++)
+	printf("%s%d", (i == 0) ? " " : ",", quanta[i]);
+    printf("; moved down %d, woken by a device %d, periodic boosts %d\n",
+	   demotions, wakeBoosts, boosts);
 }
@@ -1,6 +1,6 @@
 // scheduler.h 
 //	Data structures for the thread dispatcher and scheduler.
-//	Primarily, the list of threads that are ready to run.
+//	Primarily, the queue of threads that are ready to run.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -12,25 +12,188 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "spinlock.h"
+
+// The order in which ready threads are given the CPU.
+
+enum SchedulePolicy {
+    ScheduleFIFO,		// in the order they became ready
+    SchedulePriority,		// lowest priority # first, in FIFO order
+				// among equals; kept as a FIFO per
+				// priority, and a bitmap of the non-empty
+				// ones, for O(1) insert and pick-next
+    SchedulePriorityHeap,	// the same order, from a binary min-heap
+				// (O(log n))
+    ScheduleMLFQ		// multi-level feedback queue: the thread's
+				// priority # is its level, kept as for
+				// SchedulePriority; see Scheduler::Tick
+};
+
+#ifdef PRIORITY_SCHEDULING
+#define DefaultSchedulePolicy	SchedulePriority
+#else
+#define DefaultSchedulePolicy	ScheduleFIFO
+#endif
+
+// Multi-level feedback queue: the most levels, and the defaults for
+// the # of levels, and for the # of timer interrupts between moving
+// every thread back up to the top level.  By default, the quantum of
+// each level is twice that of the one above, starting at one timer
+// interrupt.
+
+#define MaxLevels		8
+#define DefaultLevels		4
+#define DefaultBoostPeriod	50
+
+#define BitsPerWord	32
+#define PriorityWords	((NumPriorities + BitsPerWord - 1) / BitsPerWord)
+
+// A thread on the priority heap, with its priority when it was put
+// there, and the order in which it was.
+
+struct ReadyEntry {
+    Thread *thread;
+    int priority;
+    int order;
+};
+
+// The following class defines the queue of threads that are ready to
+// run, kept according to the scheduling policy.  A thread's priority
+// is read when it is put on the queue.
+
+class ReadyQueue {
+  public:
+    ReadyQueue(SchedulePolicy queuePolicy);
+					// initialize an empty queue
+    ~ReadyQueue();			// de-allocate the queue
+
+    void Append(Thread *thread);	// Put a thread on the queue
+    Thread *Remove();			// Take the thread to run next off
+					// the queue; NULL if it's empty
+    bool IsEmpty() { return (numThreads == 0); }
+    int Length() { return numThreads; }	// # of threads on the queue
+    int FirstPriority();		// The priority of the thread to run
+					// next; NumPriorities if none
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every thread
+					// on the queue, in the order they
+					// will run
+
+  private:
+    SchedulePolicy policy;
+    int numThreads;			// # of threads on the queue
+    int nextOrder;			// insertion count, to keep equal
+					// priorities in FIFO order
+
+    List *fifo;				// ScheduleFIFO: the threads
+
+    List **queues;			// SchedulePriority: the threads of
+					// each priority
+    unsigned int nonEmpty[PriorityWords];
+					// bit p of the bitmap is set if
+					// queues[p] is not empty
+    unsigned int nonEmptyWords;		// bit w is set if nonEmpty[w] != 0
+
+    ReadyEntry *heap;			// SchedulePriorityHeap: heap[0]
+					// runs next; the children of heap[i]
+					// are at heap[2i+1] and heap[2i+2]
+    int maxThreads;			// size of the "heap" array
+
+    bool Before(ReadyEntry *a, ReadyEntry *b);
+					// Does "a" run before "b"?
+};
+
+#ifdef MULTIPROCESSOR
+#define MaxCpus		32		// the most simulated CPUs
+#else
+#define MaxCpus		1
+#endif
+
+// The ready queue of one CPU: the threads ready to run that last ran
+// on it, and the lock that keeps the other CPUs out of it; and counts
+// of how it was used, for statistics.
+
+struct CpuReadyQueue {
+    ReadyQueue *threads;		// ready threads that last ran here
+    SpinLock lock;			// protects "threads" (and "lost")
+    int appends;			// # of threads put on the queue
+    int lengthSum;			// sum of its lengths after that
+    int longest;			// the most threads it has held
+    int stealTries;			// # of times this CPU, idle, tried
+					// to take a thread from another
+    int steals;				// # of times it succeeded
+    int lost;				// # of threads others took from it
+    int migrations;			// # of threads that came to run
+					// here from another CPU
+
+    int sliceTicks;			// ScheduleMLFQ: # of timer interrupts
+					// the running thread has had
+    int boostTicks;			// # since the last periodic boost
+    int demotions;			// # of threads moved down a level
+    int wakeBoosts;			// # moved up on waking from I/O
+    int boosts;				// # of periodic boosts
+};
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
+//
+// On a multiprocessor, each CPU has its own ready queue, so the CPUs
+// don't all contend for one lock.  A thread that becomes ready goes
+// back on the queue of the CPU it last ran on, and a CPU with nothing
+// to do steals a thread from the CPU with the longest queue.
+//
+// With ScheduleMLFQ, the timer interrupt (Tick) charges the running
+// thread; when it has used up the quantum of its level, it moves down
+// a level and gives up the CPU.  A thread woken up by a device (such
+// as SynchDisk or the Console) goes back to the top level, as does
+// every ready or running thread, every so often.
+//
+// Besides turning interrupts off, the caller of FindNextToRun and Run
+// must hold the lock of this CPU's queue (Lock), as must the caller
+// of ReadyToRun for the running thread; ReadyToRun takes the lock
+// itself for any other thread.  Run returns (in the thread switched
+// to, which may have come from another CPU) with the lock still held:
+// a thread is not safe to run elsewhere until the CPU it was running
+// on has finished switching away from it.
 
 class Scheduler {
   public:
-    Scheduler();			// Initialize list of ready threads 
-    ~Scheduler();			// De-allocate ready list
+    Scheduler(SchedulePolicy schedulePolicy, int levels = DefaultLevels,
+	      int *levelQuanta = NULL, int period = DefaultBoostPeriod);
+					// Initialize queue of ready threads 
+    ~Scheduler();			// De-allocate ready queue
+
+    void Lock();			// Keep other CPUs out of this
+    void Unlock();			// CPU's ready queue (interrupts off)
 
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
-    Thread* FindNextToRun();		// Dequeue first thread on the ready 
-					// list, if any, and return thread.
+    Thread* FindNextToRun();		// Dequeue the thread to run next,
+					// if any, and return thread.
     void Run(Thread* nextThread);	// Cause nextThread to start running
-    void Print();			// Print contents of ready list
+    bool Tick();			// Charge the running thread for a
+					// timer interrupt; should it yield?
+    bool IsEmpty();			// Is no thread ready on any CPU?
+					// Without the locks, only a hint
+    void Print();			// Print contents of ready queue
+    void PrintStats();			// Print how the queues were used
+#ifdef MULTIPROCESSOR
+    Thread* Steal();			// Dequeue a thread from the CPU
+					// with the most ready, if any
+    void LockAll();			// Keep every other CPU out of
+    void UnlockAll();			// every ready queue
+#endif
     
   private:
-    List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+    CpuReadyQueue cpus[MaxCpus];	// each CPU's queue of threads that
+					// are ready to run, but not running
+    SchedulePolicy policy;
+    int numLevels;			// ScheduleMLFQ: # of levels,
+    int quanta[MaxLevels];		// the quantum of each, in timer
+					// interrupts,
+    int boostPeriod;			// and # of them between boosts
+
+    void Boost(CpuReadyQueue *cpu);	// Move this CPU's threads up to
+					// the top level
 };
 
 #endif // SCHEDULER_H
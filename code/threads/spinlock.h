@@ -0,0 +1,98 @@
+// spinlock.h
+//	Data structures for mutual exclusion between simulated CPUs.
+//
+//	On a uniprocessor, turning off interrupts is enough to make a
+//	sequence of kernel operations atomic.  When Nachos is built to
+//	simulate a multiprocessor (MULTIPROCESSOR), each CPU runs on a
+//	host thread of its own, and code on another CPU can run at the
+//	same time; so the kernel's shared data (the ready list, and each
+//	semaphore, lock and condition) is also protected by a spinlock,
+//	which a CPU busy-waits to get.
+//
+//	A spinlock is only held for a few operations, with interrupts
+//	off, and never while waiting for anything but another spinlock.
+//	Without MULTIPROCESSOR, acquiring and releasing one does nothing.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "stats.h"
+
+#ifdef MULTIPROCESSOR
+#include <sched.h>
+
+extern PerCpu Statistics *stats;	// this CPU's statistics
+
+// If the host has fewer cores than Nachos has CPUs, the CPU holding a
+// spinlock may not be running at all; so after spinning this many
+// times, a CPU lets the host run something else.
+#define SpinsBeforeYield	1000
+#endif
+
+// The following class defines a spinlock.  Besides the lock itself,
+// it counts how often it was acquired, how often it was already
+// held by another CPU (including tries that gave up), and how long
+// CPUs waited for it; each CPU's statistics count the same, for
+// every spinlock it acquired.
+
+class SpinLock {
+  public:
+    SpinLock() { held = 0; acquires = contended = spins = 0; }
+
+#ifdef MULTIPROCESSOR
+    void Acquire() {			// Wait until the lock is free,
+	int waited = 0;			// then take it
+
+	// While another CPU has it, wait until it looks free, only
+	// reading it, and then try again.
+	while (__sync_lock_test_and_set(&held, 1)) {
+	    do {
+		if (++waited % SpinsBeforeYield == 0)
+		    sched_yield();
+	    } while (held);
+	}
+	acquires++;
+	stats->numSpinLockAcquires++;
+	if (waited > 0) {
+	    contended++;
+	    spins += waited;
+	    stats->numSpinLockWaits++;
+	    stats->numSpinLockSpins += waited;
+	}
+    }
+    bool TryAcquire() {			// Take the lock if it is free;
+	if (held || __sync_lock_test_and_set(&held, 1)) {
+	    contended++;		// return whether we did
+	    stats->numSpinLockWaits++;
+	    return FALSE;
+	}
+	acquires++;
+	stats->numSpinLockAcquires++;
+	return TRUE;
+    }
+    void Release() { __sync_lock_release(&held); }
+#else
+    void Acquire() {}			// interrupts being off is enough
+    bool TryAcquire() { return TRUE; }
+    void Release() {}
+#endif
+
+    void Print(const char *name) {	// Print the counts, for statistics
+	printf("%s: acquired %d, contended %d, spins %d\n", name,
+	       acquires, contended, spins);
+    }
+
+  private:
+    volatile int held;			// is some CPU holding the lock?
+    int acquires;			// # of times the lock was acquired
+    int contended;			// # of those it was held already
+    int spins;				// # of times round the loop waiting
+};
+
+#endif // SPINLOCK_H
@@ -20,6 +20,7 @@
 #include "copyright.h"
 #include "thread.h"
 #include "list.h"
+#include "spinlock.h"
 
 
 // The following class defines a "semaphore" whose value is a non-negative
@@ -50,6 +51,7 @@ class Semaphore {
     char* name;  // useful for debugging
     int value;         // semaphore value, always >= 0
     List *queue;       // threads waiting in P() for the value to be > 0
+    SpinLock spinLock; // protects value and queue on a multiprocessor
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -134,6 +136,7 @@ class Condition {
   private:
     char* name;
     List* queue;  // threads waiting on the condition
+    SpinLock spinLock;  // protects queue on a multiprocessor
     Lock* lock;   // debugging aid:  used to check correctness of
                   // arguments to Wait, Signal and Broacast
 };
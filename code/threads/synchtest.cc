@@ -118,14 +118,13 @@ SynchThread(_int which)
     
     for (num = 0; num < 5; num++) {
         direc = num % 2;  // set direction (alternates)
-// The following printf's need fixing for the different types of _int of which
-	printf("Direction [%d], Car [%d], Arriving...\n", direc, which);
+	printf("Direction [%d], Car [%d], Arriving...\n", direc, (int) which);
 	bridge->Arrive(direc);
 	currentThread->Yield();
-	printf("Direction [%d], Car [%d], Crossing...\n", direc, which);
+	printf("Direction [%d], Car [%d], Crossing...\n", direc, (int) which);
 	bridge->Cross(direc);
 	currentThread->Yield();
-        printf("Direction [%d], Car [%d], Exiting...\n", direc, which);
+        printf("Direction [%d], Car [%d], Exiting...\n", direc, (int) which);
 	bridge->Exit(direc);
 	currentThread->Yield();
     }
@@ -8,16 +8,30 @@
 #include "copyright.h"
 #include "system.h"
 
+#ifdef MULTIPROCESSOR
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
 
-Thread *currentThread;			// the thread we are running now
-Thread *threadToBeDestroyed;  		// the thread that just finished
-Scheduler *scheduler;			// the ready list
-Interrupt *interrupt;			// interrupt status
-Statistics *stats;			// performance metrics
-Timer *timer;				// the hardware timer device,
+PerCpu Thread *currentThread;		// the thread we are running now
+PerCpu Thread *threadToBeDestroyed;	// the thread that just finished
+PerCpu int currentCpu;			// the # of the CPU we are on
+Scheduler *scheduler;			// the ready queues
+PerCpu Interrupt *interrupt;		// interrupt status
+PerCpu Statistics *stats;		// performance metrics
+PerCpu Timer *timer;			// the hardware timer device,
 					// for invoking context switches
+PerCpu Thread *idleThread;		// the CPU's idle thread, if any
+
+#ifdef MULTIPROCESSOR
+int numCpus = 1;			// # of simulated CPUs
+static Statistics *cpuStats[MaxCpus];	// the statistics of each CPU
+static volatile int idleCpus = 0;	// # of CPUs with nothing to run
+static bool timeSlicing = FALSE;	// does each CPU have a timer?
+#endif
 
 #ifdef FILESYS_NEEDED
 FileSystem  *fileSystem;
@@ -54,16 +68,142 @@ extern void Cleanup();
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
+//	The scheduler decides whether the interrupted thread has had
+//	its quantum; unless it is a multi-level feedback queue, every
+//	interrupt ends one.
+//
 //	"dummy" is because every interrupt handler takes one argument,
 //		whether it needs it or not.
 //----------------------------------------------------------------------
 static void
 TimerInterruptHandler(_int dummy)
 {
-    if (interrupt->getStatus() != IdleMode)
+    if ((interrupt->getStatus() != IdleMode) && scheduler->Tick())
 	interrupt->YieldOnReturn();
 }
 
+#ifdef MULTIPROCESSOR
+//----------------------------------------------------------------------
+// HaltAll
+// 	Called by the last simulated CPU to go idle.  With no thread
+//	running, nothing can become ready any more (the only device is
+//	the timer), so stop, and print the statistics of the machine
+//	as a whole.
+//----------------------------------------------------------------------
+
+static void
+HaltAll()
+{
+    Statistics *total = new Statistics();
+
+    printf("No threads ready or runnable, and no pending interrupts.\n");
+    printf("Assuming the program completed.\n");
+    for (int i = 0; i < numCpus; i++)
+	total->Add(cpuStats[i]);
+    stats = total;
+    interrupt->Halt();
+}
+
+//----------------------------------------------------------------------
+// CpuIdle
+// 	The idle loop of a simulated CPU, run by its idle thread when
+//	the CPU has nothing else to run.  Like a thread in Sleep, it
+//	holds the lock of the CPU's ready queue, with interrupts off.
+//
+//	It runs each thread that becomes ready on this CPU, or that it
+//	can steal from another, and comes back here when the CPU has
+//	nothing to do again.  In between, it holds no lock, and only
+//	peeks at the ready queues, letting the host run something else.
+//
+//	The CPU counts as idle while it is between the two; when every
+//	CPU is, and no thread is ready (seen with all the queues locked,
+//	so that a CPU can't be taking a thread off one meanwhile),
+//	nothing can ever run again.
+//
+//	"which" is the CPU's number.
+//----------------------------------------------------------------------
+
+static void
+CpuIdle(_int which)
+{
+    Thread *nextThread;
+
+    for (;;) {
+	if (((nextThread = scheduler->FindNextToRun()) != NULL) ||
+	    ((nextThread = scheduler->Steal()) != NULL)) {
+	    scheduler->Run(nextThread);
+	    continue;
+	}
+	scheduler->Unlock();
+	__sync_fetch_and_add(&idleCpus, 1);
+	do {
+	    if (idleCpus == numCpus) {
+		scheduler->LockAll();
+		if ((idleCpus == numCpus) && scheduler->IsEmpty())
+		    HaltAll();			// never returns
+		scheduler->UnlockAll();
+	    }
+	    sched_yield();
+	} while (scheduler->IsEmpty());
+	__sync_fetch_and_sub(&idleCpus, 1);
+	scheduler->Lock();
+    }
+}
+
+//----------------------------------------------------------------------
+// CpuStart
+// 	Start up a simulated CPU, on a host thread of its own: give it
+//	its own interrupts, statistics, timer and idle thread, and look
+//	for threads to run.
+//
+//	"arg" is the CPU's number.
+//----------------------------------------------------------------------
+
+static void *
+CpuStart(void *arg)
+{
+    int which = (int) (_int) arg;
+
+    currentCpu = which;
+    stats = cpuStats[which] = new Statistics();
+    interrupt = new Interrupt;
+    if (timeSlicing)
+	timer = new Timer(TimerInterruptHandler, 0, TRUE);
+    threadToBeDestroyed = NULL;
+    idleThread = new Thread("idle");
+    idleThread->ForkIdle(CpuIdle, which);
+
+    // As with "main", we need a Thread object to save the state of
+    // the host thread we started on.  It has nothing more to do.
+    currentThread = new Thread("boot");
+    currentThread->setStatus(RUNNING);
+    currentThread->Finish();
+    return NULL;			// not reached
+}
+
+//----------------------------------------------------------------------
+// StartCpus
+// 	Give the CPU we are on (CPU 0) an idle thread, and start up the
+//	other simulated CPUs.
+//----------------------------------------------------------------------
+
+static void
+StartCpus()
+{
+    pthread_t host;
+    int error;
+
+    cpuStats[0] = stats;
+    idleThread = new Thread("idle");
+    idleThread->ForkIdle(CpuIdle, 0);
+    for (int i = 1; i < numCpus; i++) {
+	error = pthread_create(&host, NULL, CpuStart, (void *) (_int) i);
+	ASSERT(error == 0);
+	pthread_detach(host);
+    }
+}
+#endif
+
 //----------------------------------------------------------------------
 // Initialize
 // 	Initialize Nachos global data structures.  Interpret command
@@ -80,13 +220,30 @@ Initialize(int argc, char **argv)
     int argCount;
     char* debugArgs = (char*)"";
     bool randomYield = FALSE;
+    SchedulePolicy schedulePolicy = DefaultSchedulePolicy;
+    int numLevels = DefaultLevels;	// multi-level feedback queue
+    int quanta[MaxLevels];		// levels, and their quanta,
+    int *levelQuanta = NULL;		// if not the default
+    int boostPeriod = DefaultBoostPeriod;
+    char *quantum;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    bool runBlocks = FALSE;	// run user code a basic block at a time
+    bool skipTicks = FALSE;	// fast-forward to the next interrupt
+    int numPhysPages = DefaultNumPhysPages;	// size of physical memory
+    int pageSize = DefaultPageSize;		// bytes per page
+    int tlbSize = DefaultTLBSize;		// # of TLB entries
+    int tlbWays = 0;				// TLB associativity
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
 #endif
+#ifdef FILESYS
+    int cacheSectors = DefaultCacheSize;	// size of disk buffer cache
+    bool writeBack = FALSE;	// buffer cache is write-back
+    DiskSchedule schedule = DiskCLOOK;	// order of disk requests
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     double order = 1;           // network orderability
@@ -108,15 +265,94 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-sp")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		schedulePolicy = ScheduleFIFO;
+	    else if (!strcmp(*(argv + 1), "priority"))
+		schedulePolicy = SchedulePriority;
+	    else if (!strcmp(*(argv + 1), "heap"))
+		schedulePolicy = SchedulePriorityHeap;
+	    else if (!strcmp(*(argv + 1), "mlfq"))
+		schedulePolicy = ScheduleMLFQ;
+	    else
+		ASSERT(FALSE);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-sq")) {
+	    ASSERT(argc > 1);
+	    numLevels = 0;
+	    for (quantum = strtok(*(argv + 1), ","); quantum != NULL;
+		 quantum = strtok(NULL, ",")) {
+		ASSERT(numLevels < MaxLevels);
+		quanta[numLevels++] = atoi(quantum);
+	    }
+	    levelQuanta = quanta;
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-sb")) {
+	    ASSERT(argc > 1);
+	    boostPeriod = atoi(*(argv + 1));
+	    argCount = 2;
+	}
+#ifdef MULTIPROCESSOR
+	if (!strcmp(*argv, "-cpus")) {
+	    ASSERT(argc > 1);
+	    numCpus = atoi(*(argv + 1));
+	    ASSERT((numCpus >= 1) && (numCpus <= MaxCpus));
+	    argCount = 2;
 	}
+#endif
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-bb"))
+	    runBlocks = TRUE;
+	else if (!strcmp(*argv, "-ff"))
+	    skipTicks = TRUE;
+	else if (!strcmp(*argv, "-np")) {
+	    ASSERT(argc > 1);
+	    numPhysPages = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ps")) {
+	    ASSERT(argc > 1);
+	    pageSize = atoi(*(argv + 1));
+	    argCount = 2;
+	}
+#endif
+#ifdef VM				// only the VM kernel handles TLB misses
+	if (!strcmp(*argv, "-tlb")) {
+	    ASSERT(argc > 1);
+	    tlbSize = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tlbw")) {
+	    ASSERT(argc > 1);
+	    tlbWays = atoi(*(argv + 1));
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = TRUE;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-bc")) {
+	    ASSERT(argc > 1);
+	    cacheSectors = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-wb"))
+	    writeBack = TRUE;
+	else if (!strcmp(*argv, "-ds")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		schedule = DiskFIFO;
+	    else if (!strcmp(*(argv + 1), "scan"))
+		schedule = DiskSCAN;
+	    else if (!strcmp(*(argv + 1), "clook"))
+		schedule = DiskCLOOK;
+	    else
+		ASSERT(FALSE);
+	    argCount = 2;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-n")) {
 	    ASSERT(argc > 1);
@@ -137,9 +373,10 @@ Initialize(int argc, char **argv)
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
-    scheduler = new Scheduler();		// initialize the ready queue
-    if (randomYield)				// start the timer (if needed)
-	timer = new Timer(TimerInterruptHandler, 0, randomYield);
+    scheduler = new Scheduler(schedulePolicy,	// initialize the ready queue
+			      numLevels, levelQuanta, boostPeriod);
+    if (randomYield || (schedulePolicy == ScheduleMLFQ))	// start the timer
+	timer = new Timer(TimerInterruptHandler, 0, randomYield); // (if needed)
 
     threadToBeDestroyed = NULL;
 
@@ -151,13 +388,20 @@ Initialize(int argc, char **argv)
 
     interrupt->Enable();
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
+
+#ifdef MULTIPROCESSOR
+    timeSlicing = (timer != NULL);
+    if (numCpus > 1)				// start up the other CPUs
+	StartCpus();
+#endif
     
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg);	// this must come first
+    machine = new Machine(debugUserProg, runBlocks,	// this must come first
+			  skipTicks, numPhysPages, pageSize, tlbSize, tlbWays);
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", cacheSectors, writeBack, schedule);
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -176,6 +420,18 @@ Initialize(int argc, char **argv)
 void
 Cleanup()
 {
+#ifdef MULTIPROCESSOR
+    if (numCpus > 1) {
+	for (int i = 0; i < numCpus; i++)
+	    if (cpuStats[i] != NULL)
+		printf("CPU %d: ticks %d; spinlocks: acquired %d, "
+		       "contended %d, spins %d\n", i, cpuStats[i]->totalTicks,
+		       cpuStats[i]->numSpinLockAcquires,
+		       cpuStats[i]->numSpinLockWaits,
+		       cpuStats[i]->numSpinLockSpins);
+    }
+#endif
+    scheduler->PrintStats();
     printf("\nCleaning up...\n");
 #ifdef NETWORK
     delete postOffice;
@@ -194,6 +450,10 @@ Cleanup()
 #endif
     
     delete timer;
+#ifdef MULTIPROCESSOR
+    if (numCpus > 1)		// the other CPUs may still be looking at
+	Exit(0);		// the ready queues
+#endif
     delete scheduler;
     delete interrupt;
     
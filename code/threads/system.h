@@ -22,12 +22,22 @@ extern void Initialize(int argc, char **argv); 	// Initialization,
 extern void Cleanup();				// Cleanup, called when
 						// Nachos is done.
 
-extern Thread *currentThread;			// the thread holding the CPU
-extern Thread *threadToBeDestroyed;  		// the thread that just finished
-extern Scheduler *scheduler;			// the ready list
-extern Interrupt *interrupt;			// interrupt status
-extern Statistics *stats;			// performance metrics
-extern Timer *timer;				// the hardware alarm clock
+// On a multiprocessor, each simulated CPU has its own copy of the
+// PerCpu variables (see utility.h).
+
+extern PerCpu Thread *currentThread;		// the thread holding the CPU
+extern PerCpu Thread *threadToBeDestroyed;	// the thread that just finished
+extern PerCpu int currentCpu;			// the # of the CPU we are on
+extern Scheduler *scheduler;			// the ready queues
+extern PerCpu Interrupt *interrupt;		// interrupt status
+extern PerCpu Statistics *stats;		// performance metrics
+extern PerCpu Timer *timer;			// the hardware alarm clock
+extern PerCpu Thread *idleThread;		// runs when the CPU has nothing
+						// else to; NULL on a uniprocessor
+
+#ifdef MULTIPROCESSOR
+extern int numCpus;				// # of simulated CPUs
+#endif
 
 #ifdef USER_PROGRAM
 #include "machine.h"
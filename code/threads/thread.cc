@@ -30,14 +30,23 @@
 //	Thread::Fork.
 //
 //	"threadName" is an arbitrary string, useful for debugging.
+//	"threadPriority" is clamped to MinPriority .. MaxPriority.
 //----------------------------------------------------------------------
 
-Thread::Thread(const char* threadName)
+Thread::Thread(const char* threadName, int threadPriority)
 {
     name = (char*)threadName;
+    if (threadPriority < MinPriority)
+	threadPriority = MinPriority;
+    else if (threadPriority > MaxPriority)
+	threadPriority = MaxPriority;
+    priority = threadPriority;
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+#ifdef MULTIPROCESSOR
+    cpu = currentCpu;			// it starts out on its creator's
+#endif
 #ifdef USER_PROGRAM
     space = NULL;
 #endif
@@ -61,7 +70,7 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-		DeallocBoundedArray((char *) stack, StackSize * sizeof(_int));
+		DeallocStack((char *) stack, StackSize * sizeof(_int));
 }
 
 //----------------------------------------------------------------------
@@ -87,7 +96,7 @@ Thread::~Thread()
 void 
 Thread::Fork(VoidFunctionPtr func, _int arg)
 {
-#ifdef HOST_ALPHA
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
     DEBUG('t', "Forking thread \"%s\" with func = 0x%lx, arg = %ld\n",
 	  name, (long) func, arg);
 #else
@@ -149,6 +158,7 @@ void
 Thread::Finish ()
 {
     (void) interrupt->SetLevel(IntOff);		
+    scheduler->Lock();
     ASSERT(this == currentThread);
     
     DEBUG('t', "Finishing thread \"%s\"\n", getName());
@@ -186,11 +196,13 @@ Thread::Yield ()
     
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
     
+    scheduler->Lock();
     nextThread = scheduler->FindNextToRun();
     if (nextThread != NULL) {
 	scheduler->ReadyToRun(this);
 	scheduler->Run(nextThread);
     }
+    scheduler->Unlock();
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -212,6 +224,13 @@ Thread::Yield ()
 //	disable interrupts for atomicity.   We need interrupts off 
 //	so that there can't be a time slice between pulling the first thread
 //	off the ready list, and switching to it.
+//
+//	On a multiprocessor, the caller also holds the lock of this CPU's
+//	ready queue (still held when we return), and must have taken it
+//	before letting go of whatever another CPU needs to wake us up.
+//	And we can't idle on our own stack: another CPU could wake us up
+//	and run us meanwhile.  Instead, we switch to this CPU's idle
+//	thread, which looks for work on the other CPUs.
 //----------------------------------------------------------------------
 void
 Thread::Sleep ()
@@ -224,22 +243,46 @@ Thread::Sleep ()
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
     status = BLOCKED;
-    while ((nextThread = scheduler->FindNextToRun()) == NULL)
+    while ((nextThread = scheduler->FindNextToRun()) == NULL) {
+	if (idleThread != NULL) {
+	    nextThread = idleThread;
+	    break;
+	}
 	interrupt->Idle();	// no one to run, wait for an interrupt
+    }
         
     scheduler->Run(nextThread); // returns when we've been signalled
 }
 
 //----------------------------------------------------------------------
-// ThreadFinish, InterruptEnable, ThreadPrint
+// ThreadFinish, ThreadBegin, ThreadPrint
 //	Dummy functions because C++ does not allow a pointer to a member
 //	function.  So in order to do this, we create a dummy C function
 //	(which we can pass a pointer to), that then simply calls the 
 //	member function.
+//
+//	ThreadBegin is the first thing a new thread runs.  A new thread
+//	starts in ThreadRoot, not by returning from SWITCH into
+//	Scheduler::Run, so it must delete the thread that finished
+//	before it, and release the scheduler's lock, as Run's caller
+//	would have, before enabling interrupts.  IdleBegin does the
+//	same for an idle thread, which keeps the lock and interrupts off.
 //----------------------------------------------------------------------
 
 static void ThreadFinish()    { currentThread->Finish(); }
-static void InterruptEnable() { interrupt->Enable(); }
+static void IdleBegin()
+{
+    if (threadToBeDestroyed != NULL) {
+        delete threadToBeDestroyed;
+	threadToBeDestroyed = NULL;
+    }
+}
+static void ThreadBegin()
+{
+    IdleBegin();
+    scheduler->Unlock();
+    interrupt->Enable();
+}
 void ThreadPrint(_int arg){ Thread *t = (Thread *)arg; t->Print(); }
 
 //----------------------------------------------------------------------
@@ -257,18 +300,18 @@ void ThreadPrint(_int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, _int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(_int));
+    stack = (int *) AllocStack(StackSize * sizeof(_int));
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
     stack[StackSize - 1] = STACK_FENCEPOST;
 #else
-    // i386 & MIPS & SPARC & ALPHA stack works from high addresses to low addresses
+    // i386 & x86-64 & MIPS & SPARC & ALPHA stack works from high addresses to low addresses
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
     stackTop = stack + StackSize - 96;
-#else  // HOST_MIPS  || HOST_i386 || HOST_ALPHA
+#else  // HOST_MIPS  || HOST_i386 || HOST_x86_64 || HOST_ALPHA
     stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
 #ifdef HOST_i386
     // the 80386 passes the return address on the stack.  In order for
@@ -354,12 +397,33 @@ Thread::StackAllocate (VoidFunctionPtr func, _int arg)
 #endif  // HOST_SNAKE
     
     machineState[PCState] = (_int) ThreadRoot;
-    machineState[StartupPCState] = (_int) InterruptEnable;
+    machineState[StartupPCState] = (_int) ThreadBegin;
     machineState[InitialPCState] = (_int) func;
     machineState[InitialArgState] = arg;
     machineState[WhenDonePCState] = (_int) ThreadFinish;
 }
 
+//----------------------------------------------------------------------
+// Thread::ForkIdle
+// 	Make this thread the idle thread of a simulated CPU (on a
+//	multiprocessor), to invoke (*func)(arg) the first time that CPU
+//	has nothing else to run (see Thread::Sleep).
+//
+//	Unlike Fork, the thread is not put on the ready list; only its
+//	own CPU ever switches to it.  It starts the way it will go on,
+//	with interrupts off and the scheduler's lock held.
+//
+//	"func" is the CPU's idle loop.
+//	"arg" is a single argument to be passed to it.
+//----------------------------------------------------------------------
+
+void
+Thread::ForkIdle(VoidFunctionPtr func, _int arg)
+{
+    StackAllocate(func, arg);
+    machineState[StartupPCState] = (_int) IdleBegin;
+}
+
 #ifdef USER_PROGRAM
 #include "machine.h"
 
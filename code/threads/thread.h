@@ -57,6 +57,13 @@
 #define StackSize	(sizeof(_int) * 1024)	// in words
 
 
+// Thread priorities: under a priority scheduling policy (see
+// scheduler.h), a thread with a lower priority # runs first.
+#define MinPriority	0
+#define MaxPriority	99
+#define NumPriorities	(MaxPriority + 1)
+#define DefaultPriority	9
+
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
@@ -70,6 +77,7 @@ extern void ThreadPrint(_int arg);
 //     an execution stack for activation records ("stackTop" and "stack")
 //     space to save CPU registers while not running ("machineState")
 //     a "status" (running/ready/blocked)
+//     a scheduling "priority"
 //    
 //  Some threads also belong to a user address space; threads
 //  that only run in the kernel have a NULL address space.
@@ -82,7 +90,8 @@ class Thread {
     _int machineState[MachineStateSize];  // all registers except for stackTop
 
   public:
-    Thread(const char* debugName);		// initialize a Thread 
+    Thread(const char* debugName, int priority = DefaultPriority);
+					// initialize a Thread 
     ~Thread(); 				// deallocate a Thread
 					// NOTE -- thread being deleted
 					// must not be running when delete 
@@ -91,6 +100,9 @@ class Thread {
     // basic thread operations
 
     void Fork(VoidFunctionPtr func, _int arg); 	// Make thread run (*func)(arg)
+    void ForkIdle(VoidFunctionPtr func, _int arg);
+						// Make it a CPU's idle thread,
+						// running (*func)(arg)
     void Yield();  				// Relinquish the CPU if any 
 						// other thread is runnable
     void Sleep();  				// Put the thread to sleep and 
@@ -100,7 +112,14 @@ class Thread {
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
     void setStatus(ThreadStatus st) { status = st; }
+    ThreadStatus getStatus() { return (status); }
     char* getName() { return (name); }
+    int getPriority() { return (priority); }
+    void setPriority(int newPriority) { priority = newPriority; }
+#ifdef MULTIPROCESSOR
+    int getCpu() { return (cpu); }
+    void setCpu(int which) { cpu = which; }
+#endif
     void Print() { printf("%s, ", name); }
 
   private:
@@ -111,6 +130,11 @@ class Thread {
 					// (If NULL, don't deallocate stack)
     ThreadStatus status;		// ready, running or blocked
     char* name;
+    int priority;			// MinPriority .. MaxPriority
+#ifdef MULTIPROCESSOR
+    int cpu;				// the CPU it last ran on, whose
+					// ready queue it goes back on
+#endif
 
     void StackAllocate(VoidFunctionPtr func, _int arg);
     					// Allocate a stack for thread.
@@ -25,9 +25,10 @@
 
 #include "copyright.h"
 
-#ifdef HOST_ALPHA		// Needed because of gcc uses 64 bit pointers and
-#define _int long		// 32 bit integers on the DEC ALPHA architecture.
-#else
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
+				// Needed because of gcc uses 64 bit pointers and
+#define _int long		// 32 bit integers on the DEC ALPHA and x86-64
+#else				// architectures.
 #define _int int
 #endif
 
@@ -70,7 +71,18 @@
 // as a couple of other places.
 
 typedef void (*VoidFunctionPtr)(_int arg); 
-typedef void (*VoidNoArgFunctionPtr)(); 
+typedef void (*VoidNoArgFunctionPtr)();
+
+// When Nachos simulates a multiprocessor (MULTIPROCESSOR), each CPU
+// runs on a host thread of its own.  Data declared "PerCpu" (such as
+// the current thread) is then kept separately for each CPU; otherwise
+// it is just ordinary global data.
+
+#ifdef MULTIPROCESSOR
+#define PerCpu __thread
+#else
+#define PerCpu
+#endif
 
 
 // Include interface that isolates us from the host machine system library.
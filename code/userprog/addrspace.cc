@@ -75,7 +75,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
+    ASSERT(numPages <= (unsigned) NumPhysPages);	// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
@@ -98,6 +98,8 @@ AddrSpace::AddrSpace(OpenFile *executable)
 // zero out the entire address space, to zero the unitialized data segment 
 // and the stack segment
     bzero(machine->mainMemory, size);
+    for (i = 0; i < numPages; i++)
+	machine->InvalidateDecodeCache(i);
 
 // then, copy in the code and data segments into memory
     if (noffH.code.size > 0) {
@@ -180,4 +182,5 @@ void AddrSpace::RestoreState()
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushTranslationCache();
 }